@@ -0,0 +1,490 @@
+/*
+    MIT License
+
+    Copyright (c) 2023 Le Juez Victor
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+/*
+    Benchmark of the M7 rendering paths
+
+    Renders a scripted camera path over a generated scene with vsync off and
+    prints the CPU time of each stage and the GPU time of each frame, as CSV
+    (default) or JSON, with percentiles over all the measured frames.
+
+    Usage: ./M7Bench [options]
+        --planes N      Number of ground planes, placed in a square grid (default 9)
+        --sprites N     Number of elements, 70% textures, 15% rectangles, 15% circles (default 10000)
+        --moving N      Percentage of elements moved each frame (default 1)
+        --frames N      Number of measured frames (default 1000)
+        --warmup N      Number of frames rendered before measuring (default 60)
+        --size W H      Size of the render target (default 1280 720)
+        --seed N        Seed of the scene generation (default 1)
+        --state FLAGS   Camera state flags, any of 'r' (retained), 'i' (instancing), 'd' (depth buffer)
+                        and 't' (row table), or 'none' (default "rit")
+        --far D         Far distance of the camera, 0 for none (default 0)
+        --json          Print the results as JSON instead of CSV
+*/
+
+#include <external/glad.h>      // For the GPU timer queries
+#include <raylib.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#define M7_IMPL
+#include "m7.h"
+
+#define QUERY_LATENCY 4 // Number of frames in flight before the GPU timestamps of a frame are read
+
+/* TYPES */
+
+typedef enum {
+    STAGE_UPDATE,       // Scripted camera path and moving elements
+    STAGE_BEGIN,        // M7_Camera_Begin()
+    STAGE_PLANES,       // Plane draw calls
+    STAGE_END,          // M7_Camera_End(): projection, sort and draw of the elements
+    STAGE_PRESENT,      // M7_Camera_Render() and buffer swap
+    STAGE_FRAME,        // Whole frame on the CPU
+    STAGE_GPU,          // GPU time between M7_Camera_Begin() and M7_Camera_End()
+    STAGE_COUNT
+} Stage;
+
+typedef struct {
+    int planes;
+    int sprites;
+    int moving;
+    int frames;
+    int warmup;
+    int width;
+    int height;
+    uint32_t seed;
+    unsigned int state;
+    float farDistance;
+    bool json;
+} Options;
+
+/* PRE DECLARATION */
+
+bool ParseOptions(int argc, char** argv, Options* options);
+unsigned int ParseState(const char* flags);
+
+uint32_t NextRandom(uint32_t* state);
+float RandomRange(uint32_t* state, float min, float max);
+
+void PopulateScene(M7_Camera* camera, const Options* options, Texture2D sprite, M7_Element** elements);
+void MoveElements(M7_Element** elements, const Options* options, uint32_t* random);
+void UpdateCameraPath(M7_Camera* camera, int frame);
+void DrawPlanes(M7_Camera* camera, const Options* options, Texture2D ground);
+
+int CompareDouble(const void* a, const void* b);
+double Percentile(const double* sorted, int count, double p);
+void PrintResults(const Options* options, double* samples[STAGE_COUNT], int counts[STAGE_COUNT]);
+
+static const char *stageNames[STAGE_COUNT] = {
+    "update", "begin", "planes", "end", "present", "frame", "gpu"
+};
+
+/* PROGRAM */
+
+int main(int argc, char** argv)
+{
+    Options options = {
+        .planes = 9, .sprites = 10000, .moving = 1,
+        .frames = 1000, .warmup = 60,
+        .width = 1280, .height = 720, .seed = 1,
+        .state = M7_STATE_RETAINED | M7_STATE_INSTANCING | M7_STATE_ROW_TABLE
+    };
+
+    if (!ParseOptions(argc, argv, &options)) return 1;
+
+    // Vsync off and no frame limit, only the rendering cost is measured
+
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(options.width, options.height, "M7-Bench");
+    SetTargetFPS(0);
+
+    // Generated data, so that the scene only depends on the options
+
+    Image image = GenImageChecked(512, 512, 64, 64, DARKGRAY, LIGHTGRAY);
+    Texture2D ground = LoadTextureFromImage(image);
+    UnloadImage(image);
+
+    image = GenImageChecked(16, 16, 4, 4, RED, WHITE);
+    Texture2D sprite = LoadTextureFromImage(image);
+    UnloadImage(image);
+
+    GenTextureMipmaps(&ground);
+    SetTextureFilter(ground, TEXTURE_FILTER_TRILINEAR);
+
+    M7_Camera camera = M7_Camera_Load(options.width, options.height, (Vector2) {0}, 0.0f, 80.0f, 0.5f, 0.5f, options.sprites);
+    M7_Camera_SetState(&camera, options.state);
+    M7_Camera_SetFarDistance(&camera, options.farDistance);
+
+    M7_Element **elements = (M7_Element**)calloc(options.sprites > 0 ? options.sprites : 1, sizeof(M7_Element*));
+    PopulateScene(&camera, &options, sprite, elements);
+
+    // Samples of each stage (in milliseconds), the GPU samples are read QUERY_LATENCY frames later
+
+    double *samples[STAGE_COUNT];
+    int counts[STAGE_COUNT] = {0};
+
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        samples[i] = (double*)malloc(options.frames * sizeof(double));
+    }
+
+    GLuint queries[QUERY_LATENCY][2];
+    glGenQueries(2 * QUERY_LATENCY, &queries[0][0]);
+
+    uint32_t random = options.seed ^ 0x9E3779B9u;
+    const int totalFrames = options.warmup + options.frames;
+
+    for (int frame = 0; frame < totalFrames; frame++)
+    {
+        const bool measured = (frame >= options.warmup);
+        const int slot = frame % QUERY_LATENCY;
+
+        // Results of the frame that used this pair of queries
+
+        if (frame >= QUERY_LATENCY && frame - QUERY_LATENCY >= options.warmup)
+        {
+            GLuint64 start = 0, end = 0;
+            glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+            samples[STAGE_GPU][counts[STAGE_GPU]++] = (double)(end - start) * 1e-6;
+        }
+
+        double times[STAGE_FRAME + 1];
+
+        times[STAGE_UPDATE] = GetTime();
+
+            UpdateCameraPath(&camera, frame);
+            MoveElements(elements, &options, &random);
+
+        times[STAGE_BEGIN] = GetTime();
+
+            glQueryCounter(queries[slot][0], GL_TIMESTAMP);
+            M7_Camera_Begin(&camera, SKYBLUE);
+
+        times[STAGE_PLANES] = GetTime();
+
+            DrawPlanes(&camera, &options, ground);
+
+        times[STAGE_END] = GetTime();
+
+            M7_Camera_End(&camera);
+            glQueryCounter(queries[slot][1], GL_TIMESTAMP);
+
+        times[STAGE_PRESENT] = GetTime();
+
+            BeginDrawing();
+                M7_Camera_Render(&camera);
+            EndDrawing();
+
+        times[STAGE_FRAME] = GetTime();
+
+        if (measured)
+        {
+            for (int i = STAGE_UPDATE; i < STAGE_FRAME; i++)
+            {
+                samples[i][counts[i]++] = (times[i + 1] - times[i]) * 1e3;
+            }
+
+            samples[STAGE_FRAME][counts[STAGE_FRAME]++] = (times[STAGE_FRAME] - times[STAGE_UPDATE]) * 1e3;
+        }
+    }
+
+    // Remaining GPU results
+
+    for (int frame = totalFrames; frame < totalFrames + QUERY_LATENCY; frame++)
+    {
+        const int slot = frame % QUERY_LATENCY;
+
+        if (frame - QUERY_LATENCY < options.warmup) continue;
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+        samples[STAGE_GPU][counts[STAGE_GPU]++] = (double)(end - start) * 1e-6;
+    }
+
+    PrintResults(&options, samples, counts);
+
+    // Program closure
+
+    glDeleteQueries(2 * QUERY_LATENCY, &queries[0][0]);
+
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        free(samples[i]);
+    }
+
+    free(elements);
+
+    M7_Camera_Unload(&camera);
+
+    UnloadTexture(sprite);
+    UnloadTexture(ground);
+
+    CloseWindow();
+
+    return 0;
+}
+
+/*
+    Parse the command line options, returns false after printing an error
+*/
+bool ParseOptions(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(arg, "--planes") && hasValue) options->planes = atoi(argv[++i]);
+        else if (!strcmp(arg, "--sprites") && hasValue) options->sprites = atoi(argv[++i]);
+        else if (!strcmp(arg, "--moving") && hasValue) options->moving = atoi(argv[++i]);
+        else if (!strcmp(arg, "--frames") && hasValue) options->frames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--warmup") && hasValue) options->warmup = atoi(argv[++i]);
+        else if (!strcmp(arg, "--seed") && hasValue) options->seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(arg, "--state") && hasValue) options->state = ParseState(argv[++i]);
+        else if (!strcmp(arg, "--far") && hasValue) options->farDistance = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--size") && i + 2 < argc)
+        {
+            options->width = atoi(argv[++i]);
+            options->height = atoi(argv[++i]);
+        }
+        else if (!strcmp(arg, "--json")) options->json = true;
+        else
+        {
+            fprintf(stderr, "Unknown or incomplete option '%s'\n", arg);
+            return false;
+        }
+    }
+
+    if (options->planes < 0) options->planes = 0;
+    if (options->sprites < 0) options->sprites = 0;
+    if (options->moving < 0) options->moving = 0;
+    if (options->moving > 100) options->moving = 100;
+    if (options->warmup < 0) options->warmup = 0;
+
+    if (options->frames <= 0 || options->width <= 0 || options->height <= 0)
+    {
+        fprintf(stderr, "The number of frames and the size must be positive\n");
+        return false;
+    }
+
+    return true;
+}
+
+/*
+    Convert the letters of the '--state' option to camera state flags
+*/
+unsigned int ParseState(const char* flags)
+{
+    unsigned int state = 0;
+
+    if (!strcmp(flags, "none")) return 0;
+
+    for (const char *c = flags; *c; c++)
+    {
+        switch (*c)
+        {
+            case 'r': state |= M7_STATE_RETAINED; break;
+            case 'i': state |= M7_STATE_INSTANCING; break;
+            case 'd': state |= M7_STATE_DEPTH_BUFFER; break;
+            case 't': state |= M7_STATE_ROW_TABLE; break;
+            default: fprintf(stderr, "Unknown state flag '%c' ignored\n", *c); break;
+        }
+    }
+
+    return state;
+}
+
+/*
+    Xorshift generator, used instead of rand() so that the scenes are the same on all platforms
+*/
+uint32_t NextRandom(uint32_t* state)
+{
+    uint32_t x = *state ? *state : 1;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+}
+
+float RandomRange(uint32_t* state, float min, float max)
+{
+    return min + (max - min) * (NextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+/*
+    Place the elements in the area covered by the planes
+*/
+void PopulateScene(M7_Camera* camera, const Options* options, Texture2D sprite, M7_Element** elements)
+{
+    uint32_t random = options->seed;
+
+    const float extent = 256.0f * (options->planes > 1 ? (float)ceil(sqrt(options->planes)) : 1.0f);
+    const Rectangle source = { 0, 0, (float)sprite.width, (float)sprite.height };
+
+    for (int i = 0; i < options->sprites; i++)
+    {
+        const Vector2 position = { RandomRange(&random, -extent, extent), RandomRange(&random, -extent, extent) };
+        const float size = RandomRange(&random, 4.0f, 12.0f);
+        const uint32_t type = NextRandom(&random) % 100;
+
+        if (type < 70)
+        {
+            elements[i] = M7_Texture_Add(camera, sprite, source, position, (Vector2) { size, size }, WHITE);
+        }
+        else if (type < 85)
+        {
+            elements[i] = M7_Rectangle_Add(camera, (Rectangle) { position.x, position.y, size, size }, GREEN);
+        }
+        else
+        {
+            elements[i] = M7_Circle_Add(camera, position, size * 0.5f, YELLOW);
+        }
+    }
+}
+
+/*
+    Move a fixed share of the elements, the same ones on every frame
+*/
+void MoveElements(M7_Element** elements, const Options* options, uint32_t* random)
+{
+    const int count = options->sprites * options->moving / 100;
+
+    for (int i = 0; i < count; i++)
+    {
+        M7_Element *elem = elements[i];
+
+        if (!elem) continue;
+
+        Vector2 position = elem->onWorld.position;
+        position.x += RandomRange(random, -1.0f, 1.0f);
+        position.y += RandomRange(random, -1.0f, 1.0f);
+
+        M7_Element_SetPosition(elem, position);
+    }
+}
+
+/*
+    Camera path depending only on the frame index, so that all the runs render the same frames
+*/
+void UpdateCameraPath(M7_Camera* camera, int frame)
+{
+    const float t = (float)frame;
+
+    M7_Camera_SetPosition(camera, (Vector2) { 192.0f * cosf(t * 0.010f), 192.0f * sinf(t * 0.013f) });
+    M7_Camera_SetRotation(camera, t * 0.005f);
+    M7_Camera_SetZoom(camera, 80.0f + 20.0f * sinf(t * 0.007f));
+}
+
+/*
+    Draw the planes in a square grid centered on the origin
+*/
+void DrawPlanes(M7_Camera* camera, const Options* options, Texture2D ground)
+{
+    const int columns = (int)ceil(sqrt(options->planes));
+
+    for (int i = 0; i < options->planes; i++)
+    {
+        const float x = (float)(i % columns - columns / 2) * ground.width;
+        const float y = (float)(i / columns - columns / 2) * ground.height;
+
+        M7_Camera_DrawPlane(camera, ground, (Vector2) { x, y },
+            (Vector2) { ground.width * 0.5f, ground.height * 0.5f }, (Vector2) { 1.0f, 1.0f }, false);
+    }
+}
+
+int CompareDouble(const void* a, const void* b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+    Nearest rank percentile of sorted samples
+*/
+double Percentile(const double* sorted, int count, double p)
+{
+    if (count == 0) return 0.0;
+
+    int rank = (int)ceil(p * 0.01 * count) - 1;
+
+    if (rank < 0) rank = 0;
+    if (rank >= count) rank = count - 1;
+
+    return sorted[rank];
+}
+
+/*
+    Print the statistics of each stage (in milliseconds)
+*/
+void PrintResults(const Options* options, double* samples[STAGE_COUNT], int counts[STAGE_COUNT])
+{
+    if (options->json)
+    {
+        printf("{\n  \"scene\": { \"planes\": %i, \"sprites\": %i, \"moving\": %i, \"frames\": %i, "
+               "\"width\": %i, \"height\": %i, \"seed\": %u, \"state\": %u, \"far\": %g },\n  \"stages\": [\n",
+            options->planes, options->sprites, options->moving, options->frames,
+            options->width, options->height, options->seed, options->state, options->farDistance);
+    }
+    else
+    {
+        printf("stage,samples,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n");
+    }
+
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        const int count = counts[i];
+
+        double mean = 0.0;
+        for (int j = 0; j < count; j++) mean += samples[i][j];
+        if (count > 0) mean /= count;
+
+        qsort(samples[i], count, sizeof(double), CompareDouble);
+
+        const double p50 = Percentile(samples[i], count, 50.0);
+        const double p90 = Percentile(samples[i], count, 90.0);
+        const double p99 = Percentile(samples[i], count, 99.0);
+        const double max = (count > 0) ? samples[i][count - 1] : 0.0;
+
+        if (options->json)
+        {
+            printf("    { \"stage\": \"%s\", \"samples\": %i, \"mean_ms\": %.4f, \"p50_ms\": %.4f, "
+                   "\"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f }%s\n",
+                stageNames[i], count, mean, p50, p90, p99, max, (i + 1 < STAGE_COUNT) ? "," : "");
+        }
+        else
+        {
+            printf("%s,%i,%.4f,%.4f,%.4f,%.4f,%.4f\n", stageNames[i], count, mean, p50, p90, p99, max);
+        }
+    }
+
+    if (options->json) printf("  ]\n}\n");
+}
@@ -25,16 +25,161 @@
 #ifndef M7_H
 #define M7_H
 
-#include <external/glad.h>       // For using `glUniformMatrix2fv()`
+#include <external/glad.h>       // For using `glUniformMatrix2fv()` and the instanced sprite buffers
 #include <raylib.h>
+#include <rlgl.h>                 // For flushing the raylib batch before the instanced draws and drawing the plane quads
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
 
+// Maximum number of moves per element allowed to the adaptive insertion sort before
+// the order is considered too scrambled and the radix sort is used instead (see M7_SORT_AUTO)
+#ifndef M7_SORT_INSERTION_MAX_MOVES
+#   define M7_SORT_INSERTION_MAX_MOVES 8
+#endif
+
+// Number of elements allocated at once when the element buffer of a camera grows
+#ifndef M7_POOL_CHUNK_SIZE
+#   define M7_POOL_CHUNK_SIZE 256
+#endif
+
+// Number of elements per batch given to the parallel for callback (see M7_Camera_SetParallelFor)
+#ifndef M7_JOB_BATCH_SIZE
+#   define M7_JOB_BATCH_SIZE 2048
+#endif
+
+// Number of buckets of the spatial hash grid of the elements, must be a power of two (see M7_Camera_EnableSpatialIndex)
+#ifndef M7_SPATIAL_BUCKET_COUNT
+#   define M7_SPATIAL_BUCKET_COUNT 4096
+#endif
+
+// Uniform buffer binding point of the camera parameters of the plane shaders
+#ifndef M7_UNIFORM_BINDING
+#   define M7_UNIFORM_BINDING 0
+#endif
+
+// Default maximum number of pages of a virtual texture requested per draw (see M7_VirtualTexture_Load)
+#ifndef M7_VIRTUAL_MAX_REQUESTS
+#   define M7_VIRTUAL_MAX_REQUESTS 8
+#endif
+
+// Alpha below which the texels of the opaque sprites are discarded in depth buffer mode (see M7_STATE_DEPTH_BUFFER)
+#ifndef M7_DEPTH_ALPHA_CUTOFF
+#   define M7_DEPTH_ALPHA_CUTOFF 0.5f
+#endif
+
+// Highest mipmap level sampled on the planes by default (see M7_Camera_SetMaxLOD)
+#ifndef M7_MAX_LOD
+#   define M7_MAX_LOD 16.0f
+#endif
+
+// Number of rows of the view given to each batch of the parallel for callback by the software backend (see M7_Camera_LoadSoftware)
+#ifndef M7_SOFTWARE_BATCH_ROWS
+#   define M7_SOFTWARE_BATCH_ROWS 16
+#endif
+
+// Maximum width and height of the texture of a sprite atlas (see M7_SpriteAtlas_Load)
+#ifndef M7_SPRITE_ATLAS_MAX_SIZE
+#   define M7_SPRITE_ATLAS_MAX_SIZE 4096
+#endif
+
+// Default number of bytes of pixels uploaded by an asset loader per update (see M7_Loader_Load)
+#ifndef M7_LOADER_UPLOAD_BUDGET
+#   define M7_LOADER_UPLOAD_BUDGET (1 << 20)
+#endif
+
+// Size of the screen cells in which the draw list is binned for the picking (in pixels, see M7_Camera_Pick)
+#ifndef M7_PICK_CELL_SIZE
+#   define M7_PICK_CELL_SIZE 32
+#endif
+
+// Alpha below which the texels of the sprites are not hit by M7_Camera_PickPixel()
+#ifndef M7_PICK_ALPHA_CUTOFF
+#   define M7_PICK_ALPHA_CUTOFF 0.5f
+#endif
+
+// Size of the name of a texture reference in a scene file, including the terminating zero (see M7_Scene_Load)
+#ifndef M7_SCENE_NAME_SIZE
+#   define M7_SCENE_NAME_SIZE 64
+#endif
+
+// Define M7_STATS to measure the CPU and GPU time of each rendering stage and count the draw calls
+// (see M7_Camera_GetStats, without it the measures are compiled out and the stats stay at zero)
+
+// SIMD instruction set used by the batch conversions M7_ToScreenN() and M7_ToWorldN()
+// (define M7_NO_SIMD to always use the scalar version)
+#ifndef M7_NO_SIMD
+#   if defined(__AVX2__)
+#       include <immintrin.h>
+#       define M7_SIMD_AVX2
+#   elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       include <emmintrin.h>
+#       define M7_SIMD_SSE2
+#   elif defined(__ARM_NEON) && defined(__aarch64__)
+#       include <arm_neon.h>
+#       define M7_SIMD_NEON
+#   endif
+#endif
+
+// Atomic exchange and load of the index of the published snapshot buffer, shared by the simulation
+// and the rendering threads (see M7_Snapshot, define both to use other primitives)
+#ifndef M7_ATOMIC_EXCHANGE
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#       define M7_ATOMIC_EXCHANGE(pointer, value) _InterlockedExchange((volatile long*)(pointer), (long)(value))
+#       define M7_ATOMIC_LOAD(pointer) _InterlockedOr((volatile long*)(pointer), 0)
+#   else
+#       define M7_ATOMIC_EXCHANGE(pointer, value) __atomic_exchange_n((pointer), (value), __ATOMIC_ACQ_REL)
+#       define M7_ATOMIC_LOAD(pointer) __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#   endif
+#endif
+
 typedef struct {
     float m0, m1;  // First row of the matrix (2 components)
     float m2, m3;  // Second row of the matrix (2 components)
 } Matrix2x2;
 
+/*
+    Uniform block of the camera parameters shared by the plane shaders
+    (same layout as M7_CameraUniforms)
+*/
+
+#define M7_CAMERA_BLOCK \
+    "layout (std140) uniform M7_CameraBlock" \
+    "{" \
+        "mat2 camRot;" \
+        "vec4 fogColor;" \
+        "vec2 fogRange;" \
+        "vec2 targetSize;" \
+        "float offset;" \
+        "float zoom;" \
+        "float fov;" \
+        "float rowCount;" \
+        "int useRowTable;" \
+    "};"
+
+/*
+    Start of the main function of the plane shaders: world distance 'depth' of the row in front
+    of the camera (same as M7_Camera_GetDepth()) and its 'fog' factor, the rows beyond the far
+    distance being filled with the fog color without any sampling (uses M7_CAMERA_BLOCK)
+*/
+
+#define M7_FOG_PROLOGUE \
+    "float v = fragTexCoord.y;" \
+    "float depth = (offset / v - 1.0) * zoom / fov;" \
+    "float fog = 0.0;" \
+    "if (fogRange.y > 0.0)" \
+    "{" \
+        "if (depth >= fogRange.y)" \
+        "{" \
+            "fragColor = fogColor;" \
+            "return;" \
+        "}" \
+        "fog = clamp((depth - fogRange.x) / max(fogRange.y - fogRange.x, 1e-5), 0.0, 1.0);" \
+    "}"
+
 /*
     Fragment shader for rendering the plane
 */
@@ -49,32 +194,374 @@ static const char M7_PlaneFragment[] =
     "uniform vec2 mapSize;"
 
     "uniform vec2 camPos;"
-    "uniform mat2 camRot;"
+    "uniform int wrap;"
+    "uniform float maxLod;"
 
-    "uniform float offset;"
-    "uniform float zoom;"
-    "uniform float fov;"
+    "uniform sampler2D rowTable;"
+
+    M7_CAMERA_BLOCK
+
+    "void main()"
+    "{"
+        M7_FOG_PROLOGUE
+
+        // With the row table, the start and the step of the row in camera space
+        // are fetched and only a multiply-add is left (see M7_Camera_UpdateRowTable())
+
+        "vec2 uv;"
+
+        "if (useRowTable != 0)"
+        "{"
+            "vec4 row = texelFetch(rowTable, ivec2(int(fragTexCoord.y * rowCount), 0), 0);"
+            "uv = row.xy + fragTexCoord.x * row.zw;"
+        "}"
+        "else"
+        "{"
+            "uv = ((vec2(0.5, offset) - fragTexCoord) * vec2(zoom, zoom/fov)) * camRot / fragTexCoord.y;"
+        "}"
+
+        "uv = (uv + camPos) / mapSize;"
+
+        "if (wrap == 0 && (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0))"
+        "{"
+            "fragColor = vec4(0.0);"
+            "return;"
+        "}"
+
+        // Analytic LOD from the world size of the pixel on the row, across the row
+        // and between two rows, instead of the screen space derivatives of 'uv'
+
+        "float footprint = max(zoom / (v * targetSize.x), offset * zoom / (fov * v * v * targetSize.y));"
+        "vec2 texelsPerUnit = vec2(textureSize(map, 0)) / mapSize;"
+        "float lod = clamp(log2(footprint * max(texelsPerUnit.x, texelsPerUnit.y)), 0.0, maxLod);"
+
+        "fragColor = mix(textureLod(map, uv, lod), fogColor, fog);"
+    "}";
+
+/*
+    Fragment shader for rendering a tilemap plane
+    (all the tiles of the map are resolved in a single pass)
+*/
+
+static const char M7_TilemapFragment[] =
+    "#version 330\n"
+
+    "in vec2 fragTexCoord;"
+    "out vec4 fragColor;"
+
+    "uniform sampler2D atlas;"
+    "uniform sampler2D tiles;"
+
+    "uniform vec2 atlasSize;"
+    "uniform vec2 tileSize;"
+    "uniform ivec2 gridSize;"
+    "uniform vec2 mapSize;"
+
+    "uniform vec2 camPos;"
     "uniform int wrap;"
+    "uniform float maxLod;"
+
+    "uniform sampler2D rowTable;"
+
+    M7_CAMERA_BLOCK
 
     "void main()"
     "{"
-        "vec2 uv = ((vec2(0.5, offset) - fragTexCoord) * vec2(zoom, zoom/fov)) * camRot;"
-        "uv = (uv / fragTexCoord.y + camPos) / mapSize;"
+        M7_FOG_PROLOGUE
+
+        // With the row table, the start and the step of the row in camera space
+        // are fetched and only a multiply-add is left (see M7_Camera_UpdateRowTable())
+
+        "vec2 uv;"
+
+        "if (useRowTable != 0)"
+        "{"
+            "vec4 row = texelFetch(rowTable, ivec2(int(fragTexCoord.y * rowCount), 0), 0);"
+            "uv = row.xy + fragTexCoord.x * row.zw;"
+        "}"
+        "else"
+        "{"
+            "uv = ((vec2(0.5, offset) - fragTexCoord) * vec2(zoom, zoom/fov)) * camRot / fragTexCoord.y;"
+        "}"
+
+        "uv = (uv + camPos) / mapSize;"
 
         "if (wrap == 0 && (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0))"
         "{"
             "fragColor = vec4(0.0);"
+            "return;"
+        "}"
+
+        "vec2 cellPos = fract(uv) * vec2(gridSize);"
+        "ivec2 cell = clamp(ivec2(cellPos), ivec2(0), gridSize - 1);"
+        "int tile = int(texelFetch(tiles, cell, 0).r);"
+
+        "if (tile < 0)"
+        "{"
+            "fragColor = vec4(0.0);"
+            "return;"
+        "}"
+
+        // Position of the tile in the atlas, the texel is kept half a texel
+        // away from the tile edges to avoid bleeding with the neighboring tiles
+
+        "int columns = max(int(atlasSize.x / tileSize.x), 1);"
+        "vec2 tileOrigin = vec2(tile % columns, tile / columns) * tileSize;"
+        "vec2 texel = clamp(fract(cellPos) * tileSize, vec2(0.5), tileSize - 0.5);"
+
+        // Analytic LOD from the world size of the pixel on the row, so that
+        // the mipmap selection is not disturbed by the tile edges
+
+        "float footprint = max(zoom / (v * targetSize.x), offset * zoom / (fov * v * v * targetSize.y));"
+        "vec2 texelsPerUnit = tileSize * vec2(gridSize) / mapSize;"
+        "float lod = clamp(log2(footprint * max(texelsPerUnit.x, texelsPerUnit.y)), 0.0, maxLod);"
+
+        "fragColor = mix(textureLod(atlas, (tileOrigin + texel) / atlasSize, lod), fogColor, fog);"
+    "}";
+
+/*
+    Fragment shader for rendering a virtual texture plane
+    (the texels are read from the pages of the map resident in the cache)
+*/
+
+static const char M7_VirtualFragment[] =
+    "#version 330\n"
+
+    "in vec2 fragTexCoord;"
+    "out vec4 fragColor;"
+
+    "uniform sampler2D cache;"
+    "uniform sampler2D pageTable;"
+
+    "uniform vec2 mapTexels;"
+    "uniform float pageSize;"
+    "uniform vec4 fallbackColor;"
+    "uniform vec2 mapSize;"
+
+    "uniform vec2 camPos;"
+    "uniform int wrap;"
+
+    "uniform sampler2D rowTable;"
+
+    M7_CAMERA_BLOCK
+
+    "void main()"
+    "{"
+        M7_FOG_PROLOGUE
+
+        // With the row table, the start and the step of the row in camera space
+        // are fetched and only a multiply-add is left (see M7_Camera_UpdateRowTable())
+
+        "vec2 uv;"
+
+        "if (useRowTable != 0)"
+        "{"
+            "vec4 row = texelFetch(rowTable, ivec2(int(fragTexCoord.y * rowCount), 0), 0);"
+            "uv = row.xy + fragTexCoord.x * row.zw;"
         "}"
         "else"
         "{"
-            "fragColor = texture(map, uv);"
+            "uv = ((vec2(0.5, offset) - fragTexCoord) * vec2(zoom, zoom/fov)) * camRot / fragTexCoord.y;"
+        "}"
+
+        "uv = (uv + camPos) / mapSize;"
+
+        "if (wrap == 0 && (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0))"
+        "{"
+            "fragColor = vec4(0.0);"
+            "return;"
+        "}"
+
+        // The page of the texel gives the slot of the cache that holds it, the texel is kept
+        // half a texel away from the page edges to avoid bleeding with the neighboring slots
+
+        "ivec2 pages = textureSize(pageTable, 0);"
+        "vec2 texel = fract(uv) * mapTexels;"
+        "ivec2 page = clamp(ivec2(texel / pageSize), ivec2(0), pages - 1);"
+        "vec4 entry = texelFetch(pageTable, page, 0);"
+
+        "if (entry.a < 0.5)"
+        "{"
+            "fragColor = mix(fallbackColor, fogColor, fog);"
+            "return;"
+        "}"
+
+        "vec2 inPage = clamp(texel - vec2(page) * pageSize, vec2(0.5), vec2(pageSize - 0.5));"
+        "vec2 slot = floor(entry.rg * 255.0 + 0.5) * pageSize;"
+
+        "fragColor = mix(textureLod(cache, (slot + inPage) / vec2(textureSize(cache, 0)), 0.0), fogColor, fog);"
+    "}";
+
+/*
+    Vertex and fragment shaders for the instanced rendering of sprites
+    (the projection is the same as the one of M7_ToScreen())
+*/
+
+static const char M7_SpriteVertex[] =
+    "#version 330\n"
+
+    "layout (location = 0) in vec2 instPosition;"
+    "layout (location = 1) in vec2 instScale;"
+    "layout (location = 2) in vec4 instSource;"
+    "layout (location = 3) in vec4 instTint;"
+
+    "out vec2 fragTexCoord;"
+    "out vec4 fragColor;"
+
+    "uniform vec2 targetSize;"
+    "uniform vec2 texSize;"
+
+    "uniform vec2 camPos;"
+    "uniform mat2 camRot;"
+
+    "uniform float offset;"
+    "uniform float zoom;"
+    "uniform float fov;"
+
+    "void main()"
+    "{"
+        // Same projection as M7_ToScreen()
+
+        "vec2 obj = vec2(instPosition.x - camPos.x, camPos.y - instPosition.y) / zoom;"
+
+        "float spaceX = -dot(obj, camRot[0]);"
+        "float spaceY = dot(obj, camRot[1]) * fov;"
+        "float distance = 1.0 - spaceY;"
+
+        "vec2 screenPos = vec2("
+            "(spaceX / distance) * offset * targetSize.x + targetSize.x * 0.5,"
+            "((spaceY + offset - 1.0) / distance) * targetSize.y + targetSize.y);"
+
+        "float size = (offset * targetSize.x) / (zoom * distance);"
+
+        // Same screen rectangle as M7_ZBuffer_Element_Update()
+
+        "vec2 scale = (size * instScale) / instSource.zw;"
+
+        "vec4 rect = vec4("
+            "screenPos.x - (instSource.z * scale.x) * 0.5,"
+            "screenPos.y - instSource.w * scale.y,"
+            "instSource.z * scale.x,"
+            "instSource.z * scale.y);"
+
+        // Elements behind the camera have their scale flipped,
+        // they are discarded as in M7_ZBuffer_Element_Draw()
+
+        "if ((scale.x > 0.0) != (instScale.x > 0.0) || (scale.y > 0.0) != (instScale.y > 0.0))"
+        "{"
+            "gl_Position = vec4(2.0, 2.0, 2.0, 1.0);"
+            "return;"
         "}"
+
+        // Corners of the quad in counter-clockwise triangle strip order,
+        // the texture coordinates are flipped like DrawTexturePro() does
+
+        "vec2 corner = vec2(gl_VertexID / 2, gl_VertexID % 2);"
+        "vec2 texCorner = mix(corner, 1.0 - corner, lessThan(instSource.zw, vec2(0.0)));"
+
+        "vec2 pos = rect.xy + corner * rect.zw;"
+
+        "fragTexCoord = (instSource.xy + texCorner * abs(instSource.zw)) / texSize;"
+        "fragColor = instTint;"
+
+        // Same depth as M7_ZBuffer_Element_GetDepth(), converted from the
+        // view space of the raylib render texture ortho projection to NDC
+
+        "float depth = 2.0 / (1.0 + max(size, 0.0)) - 1.0;"
+
+        "gl_Position = vec4(pos.x / targetSize.x * 2.0 - 1.0, 1.0 - pos.y / targetSize.y * 2.0, depth, 1.0);"
+    "}";
+
+static const char M7_SpriteFragment[] =
+    "#version 330\n"
+
+    "in vec2 fragTexCoord;"
+    "in vec4 fragColor;"
+
+    "out vec4 finalColor;"
+
+    "uniform sampler2D texture0;"
+    "uniform float alphaCutoff;"
+
+    "void main()"
+    "{"
+        "vec4 color = texture(texture0, fragTexCoord) * fragColor;"
+        "if (color.a < alphaCutoff) discard;"
+        "finalColor = color;"
+    "}";
+
+/*
+    Fragment shader for rendering the opaque elements with raylib in depth buffer mode
+    (used with the default raylib vertex shader)
+*/
+
+static const char M7_AlphaTestFragment[] =
+    "#version 330\n"
+
+    "in vec2 fragTexCoord;"
+    "in vec4 fragColor;"
+
+    "out vec4 finalColor;"
+
+    "uniform sampler2D texture0;"
+    "uniform vec4 colDiffuse;"
+    "uniform float alphaCutoff;"
+
+    "void main()"
+    "{"
+        "vec4 color = texture(texture0, fragTexCoord) * colDiffuse * fragColor;"
+        "if (color.a < alphaCutoff) discard;"
+        "finalColor = color;"
+    "}";
+
+/*
+    Fragment shader writing the identifiers of the elements, given as their vertex color, for the picking
+    (used with the default raylib vertex shader)
+*/
+
+static const char M7_PickFragment[] =
+    "#version 330\n"
+
+    "in vec2 fragTexCoord;"
+    "in vec4 fragColor;"
+
+    "out vec4 finalColor;"
+
+    "uniform sampler2D texture0;"
+    "uniform float alphaCutoff;"
+
+    "void main()"
+    "{"
+        "if (texture(texture0, fragTexCoord).a < alphaCutoff) discard;"
+        "finalColor = fragColor;"
     "}";
 
 /*
     Z-Buffer rendering system (structs)
 */
 
+// Spatial hash grid of the elements of a Z-Buffer, indexed by element slot
+// (allocated on the heap so that the elements can reference it while the camera struct is copied)
+typedef struct M7_SpatialIndex {
+    float cellSize;         // Size of a cell of the grid (in world units)
+    uint32_t *buckets;      // First slot of each bucket of cells (M7_SPATIAL_BUCKET_COUNT)
+    uint32_t *next;         // Next slot in the same bucket
+    uint32_t *prev;         // Previous slot in the same bucket
+    int32_t *cellX;         // Cell of each slot
+    int32_t *cellY;
+    uint32_t *stamps;       // Frame on which each slot was last returned by a query
+    uint32_t *moved;        // Stack of the slots whose element has been modified since the last frame
+    bool *queued;           // Indicates that a slot is in the 'moved' stack
+    uint32_t *candidates;   // Dense indices of the elements returned by the last query
+    uint32_t candidateCount;// Number of elements returned by the last query
+    uint32_t movedCount;    // Number of slots in the 'moved' stack
+    uint32_t capacity;      // Number of slots of the arrays (same as the buffer)
+    uint32_t frame;         // Incremented on each query
+    bool active;            // Indicates that the last query has been used to update the elements
+    float extentX;          // Largest half width of the elements (in world units)
+    float extentY;          // Largest height of the elements (in world units)
+} M7_SpatialIndex;
+
 struct M7_ZBuffer_Element_SpaceData {
     Rectangle rectangle;
     Vector2 position;
@@ -91,92 +578,622 @@ typedef struct {
 
     // Represents world coordinates provided by the user
     // (for textures, 'onWorld.rectangle' represents the source rectangle of the texture)
+    // The screen display coordinates and the distance are no longer fields of the element ('onScreen' and
+    // 'distance' have been removed), each camera keeps its own ones, read with M7_Camera_GetElementScreen()
     struct M7_ZBuffer_Element_SpaceData onWorld;
 
-    // Represents screen display coordinates
-    struct M7_ZBuffer_Element_SpaceData onScreen;
-
     Texture2D texture;  // The texture associated with the element
-    float distance;     // The distance of the element with camera
+    const Image *image; // Pixels of the texture for the software backend (RGBA8, NULL if the element is only drawn with GL)
     Color tint;         // The tint color of the element
 
     enum M7_ZBuffer_Element_Type type;  // The type of the ZBuffer element
 
+    uint32_t revision;  // Incremented each time the element is modified, the cameras project it again when it differs (retained mode)
+
+    uint32_t slot;          // Slot of the element in the buffer
+    uint32_t generation;    // Generation of the slot, incremented each time an element is removed from it
+    uint32_t index;         // Index of the element in the transform arrays of the buffer
+    M7_SpatialIndex *grid;  // Spatial index notified when the element is modified (NULL if the buffer has none)
+    bool alive;             // Indicates that the slot is used by an element
+
 } M7_ZBuffer_Element;
 
 typedef M7_ZBuffer_Element M7_Element;
 
+// Stable reference to an element, which can be checked after the element has been removed
+typedef struct {
+    uint32_t slot;
+    uint32_t generation;
+} M7_Handle;
+
+typedef enum {
+    M7_SORT_NONE,       // No sort (reported when the sort has been skipped)
+    M7_SORT_AUTO,       // Adaptive insertion sort on the previous order, falling back to a radix sort when it is too scrambled
+    M7_SORT_QUICK,      // Standard library qsort()
+    M7_SORT_INSERTION,  // Insertion sort on the previous order only
+    M7_SORT_RADIX       // LSD radix sort on the distance key only
+} M7_SortMode;
+
+// Entry of the rendering order, the key is the distance converted to an unsigned integer preserving its order
+typedef struct {
+    uint32_t key;       // Sort key of the element
+    uint32_t index;     // Index of the element in the transform arrays
+} M7_ZBuffer_SortKey;
+
+// Transform inputs of the elements, stored in separate arrays indexed by 'M7_ZBuffer_Element.index'
+typedef struct {
+    float *data;        // Single allocation holding all the arrays below
+    float *positionX;   // World position of the elements (copied from 'onWorld.position')
+    float *positionY;
+    float *scaleX;      // World scale of the elements (copied from 'onWorld.scale')
+    float *scaleY;
+    float *width;       // Source size of the elements (copied from 'onWorld.rectangle')
+    float *height;
+} M7_ZBuffer_Transforms;
+
+// Projection and rendering order of the elements of a Z-Buffer by one camera, indexed like the transform arrays
+// (allocated on the heap so that the buffer can reference it while the camera struct is copied)
+typedef struct M7_ZBuffer_View {
+    float *data;                        // Single allocation holding the three projection arrays below
+    float *screenX;                     // Projected position of the elements
+    float *screenY;
+    float *distance;                    // Projected size of the elements
+    struct M7_ZBuffer_Element_SpaceData *onScreen; // Screen display coordinates of the elements
+    uint32_t *revisions;                // Revision of each element when it was last projected (0 if it has never been)
+    bool *visible;                      // Indicates that each element overlaps the render target (set by the last projection)
+    M7_ZBuffer_SortKey *order;          // Rendering order of the elements, sorted by depth
+    M7_ZBuffer_SortKey *orderTemp;      // Temporary rendering order used by the radix sort and the partition
+    uint32_t *orderOf;                  // Position of each element in the rendering order
+    uint32_t *batchUpdated;             // Number of elements updated by each batch of M7_JOB_BATCH_SIZE elements
+    struct M7_ZBuffer_View *next;       // Next view of the same buffer
+    uint32_t capacity;                  // Number of elements of the arrays (at least the capacity of the buffer)
+    uint32_t visibleCount;              // Number of visible elements at the start of 'order' (the draw list)
+    uint32_t translucentCount;          // Number of translucent elements at the start of 'order' (depth buffer mode)
+    uint32_t sortedCount;               // Number of elements at the start of 'order' sorted on the last frame
+    bool orderDirty;                    // Indicates that the rendering order must be partitioned again (an element has been removed)
+    uint32_t version;                   // Camera version with which the elements were last projected (retained mode)
+    M7_SortMode sortMode;               // Sort strategy used by the camera
+    M7_SortMode lastSort;               // Sort path that ran on the last frame
+} M7_ZBuffer_View;
+
 typedef struct {
-    M7_ZBuffer_Element **ptrElems; // Array of pointers to the original elements (This array will be sorted in the order of rendering based on depth)
-    M7_ZBuffer_Element *elems;     // Array of elements
-    uint32_t maxCount;             // Maximum capacity of the buffer
-    uint32_t count;                // Number of elements currently in the buffer
+    M7_ZBuffer_Transforms transforms;   // Transform arrays of the elements (same order as 'elems')
+    M7_ZBuffer_Element **elems;         // Pointers to the elements, indexed like the transform arrays
+    M7_ZBuffer_Element **chunks;        // Chunks of M7_POOL_CHUNK_SIZE elements (never moved, so the pointers to the elements stay valid)
+    uint32_t *freeSlots;                // Stack of the free element slots
+    M7_SpatialIndex *grid;              // Spatial index of the elements (NULL if disabled)
+    M7_ZBuffer_View *views;             // Views of the cameras rendering the elements, kept in step with the transform arrays
+    uint32_t chunkCount;                // Number of allocated chunks
+    uint32_t capacity;                  // Current capacity of the buffer (grows by chunks)
+    uint32_t freeCount;                 // Number of free slots
+    uint32_t count;                     // Number of elements currently in the buffer
 } M7_ZBuffer;
 
+// Elements of the world, owned by one camera or shared by several cameras (see M7_Camera_ShareWorld)
+typedef struct {
+    M7_ZBuffer buffer;      // The ZBuffer of the elements
+    uint32_t refCount;      // Number of cameras rendering the elements
+} M7_World;
+
+// Data of the update jobs of the elements
+typedef struct {
+    const struct M7_Camera *camera;
+    const uint32_t *indices;    // Dense indices of the elements to update (NULL to update all the elements)
+    uint32_t count;             // Number of elements to update
+    float minDistance;          // Distance below which the elements are beyond the far distance of the camera
+} M7_ZBuffer_UpdateData;
+
+// Per-sprite attributes sent to the instanced sprite shader
+typedef struct {
+    float position[2];      // World position of the sprite
+    float scale[2];         // World scale of the sprite
+    float source[4];        // Source rectangle in the texture
+    unsigned char tint[4];  // Tint color of the sprite
+} M7_SpriteInstance;
+
 /*
-    Camera struct
+    Tilemap struct
 */
 
-typedef struct M7_Camera {
+typedef struct {
+    Texture2D atlas;    // Texture containing all the tiles of the map (read from left to right, top to bottom)
+    Texture2D indices;  // Texture of the tile indices (one texel per tile, read by the tilemap shader)
+    float *tiles;       // Tile indices of the map (-1 for an empty tile)
+    int tileWidth;      // Width of a tile in the atlas (in pixels)
+    int tileHeight;     // Height of a tile in the atlas (in pixels)
+    int width;          // Width of the map (in tiles)
+    int height;         // Height of the map (in tiles)
+    bool dirty;         // Indicates that the indices must be uploaded before the next draw
+} M7_Tilemap;
 
-    struct { // An instance per camera of the plane rendering shader
+/*
+    Sprite atlas struct
+*/
 
-        Shader shader;      // The shader used for rendering
+// Texture packed into a sprite atlas
+typedef struct {
+    Texture2D source;   // The packed texture (not owned by the atlas)
+    Rectangle rect;     // Area of the texture in the atlas (in pixels)
+} M7_SpriteAtlas_Entry;
 
-        int locMapTex;      // Location of the map texture uniform
-        int locMapSize;     // Location of the map size uniform
+typedef struct {
+    Texture2D texture;              // Texture into which the sprite textures are packed
+    M7_SpriteAtlas_Entry *entries;  // Textures packed into the atlas
+    int count;                      // Number of packed textures
+    int padding;                    // Space left between the packed textures (in pixels)
+} M7_SpriteAtlas;
 
-        int locCamPos;      // Location of the camera position uniform
-        int locCamRot;      // Location of the camera rotation uniform
+/*
+    Virtual texture struct
+*/
 
-        int locZoom;        // Location of the zoom uniform
-        int locFOV;         // Location of the field of view uniform
-        int locOffset;      // Location of the offset uniform
-        int locWrap;        // Location of the wrap uniform
+// Callback asking for the pixels of a page of a virtual texture, which have to be given back with
+// M7_VirtualTexture_SubmitPage() on the rendering thread, either from the callback or on a later frame
+// (the pages can be read on other threads in the meantime, the request is not repeated until then)
+typedef void (*M7_PageRequest)(int pageX, int pageY, void* userData);
 
-    } planeProgram;
+// Page of a virtual texture missing under the view, with its depth in front of the camera
+typedef struct {
+    float depth;
+    uint32_t page;
+} M7_PageCandidate;
 
-    RenderTexture target;   // The render target
-    M7_ZBuffer buffer;      // The ZBuffer
+typedef struct {
+    Texture2D cache;        // Texture of the resident pages (RGBA8, cacheColumns x cacheRows pages)
+    Texture2D pageTable;    // Texture of the cache slot of each page (one RGBA8 texel per page, the alpha is zero for a missing page)
+    uint8_t *table;         // Texels of the page table
+    uint8_t *states;        // State of each page (missing, requested or resident)
+    uint32_t *slotPages;    // Page held by each slot of the cache (UINT32_MAX for a free slot)
+    uint32_t *slotStamps;   // Frame on which each slot was last under the view
+    M7_PageCandidate *candidates; // Missing pages under the view gathered on the last draw
+    M7_PageRequest request; // Callback asking for the missing pages
+    void *userData;         // User data given to the request callback
+    Color fallback;         // Color of the missing pages (transparent by default)
+    int width;              // Width of the map (in pixels)
+    int height;             // Height of the map (in pixels)
+    int pageSize;           // Size of a page (in pixels)
+    int pagesX;             // Width of the map (in pages)
+    int pagesY;             // Height of the map (in pages)
+    int cacheColumns;       // Width of the cache (in pages)
+    int cacheRows;          // Height of the cache (in pages)
+    uint32_t maxRequests;   // Maximum number of pages requested per draw, the nearest ones first
+    uint32_t frame;         // Incremented on each draw
+    bool dirty;             // Indicates that the page table must be uploaded before the next draw
+} M7_VirtualTexture;
 
-    Matrix2x2 rotMat;       // Rotation matrix
-    Vector2 position;       // Camera position
+/*
+    Asset loader struct
+*/
 
-    float rotation;         // Camera rotation
-    float zoom;             // Camera zoom
-    float fov;              // Field of view
-    float offset;           // Offset
+// Callback asking for the pixels of an asset, called on the rendering thread by M7_Loader_Update(),
+// which is expected to decode them on a worker thread with M7_Asset_Decode() then to call
+// M7_Loader_Submit() on the rendering thread, either from the callback or on a later frame
+struct M7_Asset;
+typedef void (*M7_AssetRequest)(struct M7_Asset* asset, void* userData);
+
+typedef enum {
+    M7_ASSET_QUEUED,        // Waiting to be requested
+    M7_ASSET_REQUESTED,     // Being decoded (until M7_Loader_Submit() is called)
+    M7_ASSET_DECODED,       // Decoded, waiting to be uploaded
+    M7_ASSET_UPLOADING,     // Being uploaded, some rows on each update
+    M7_ASSET_READY,         // Uploaded, 'texture' is the loaded texture
+    M7_ASSET_FAILED         // Could not be decoded or uploaded, 'texture' stays the placeholder
+} M7_AssetState;
+
+typedef struct M7_Asset {
+    Texture2D texture;      // Texture to draw, the placeholder until the asset is ready
+    Texture2D placeholder;  // Texture of a single texel drawn until the asset is ready (unique to the asset)
+    Texture2D uploaded;     // Texture into which the pixels are uploaded
+    Image image;            // Decoded pixels (RGBA8), freed once uploaded
+    char *fileName;         // File of the asset
+    M7_AssetState state;    // Loading state of the asset
+    int uploadedRows;       // Number of rows of the image already uploaded
+    bool mipmaps;           // Generate the mipmaps of the texture once uploaded
+} M7_Asset;
 
-    float aspect;           // RenderTexture aspect ratio
+typedef struct {
+    M7_Asset **assets;      // Assets of the loader (allocated one by one, so the pointers stay valid)
+    M7_AssetRequest request;// Callback asking for the decoding of the assets (NULL to decode them on the rendering thread)
+    void *userData;         // User data given to the request callback
+    unsigned int pbo;       // Pixel unpack buffer through which the pixels are uploaded
+    size_t uploadBudget;    // Number of bytes of pixels uploaded per update
+    Color fallback;         // Color of the placeholders of the assets added hereafter (gray by default)
+    int count;              // Number of assets
+    int capacity;           // Capacity of the asset array
+} M7_Loader;
 
-} M7_Camera;
+/*
+    Scene struct
+*/
+
+#define M7_SCENE_VERSION 1
+
+// Header of a scene file, followed by 'textureCount' names of M7_SCENE_NAME_SIZE bytes then by 'elementCount' records
+// (the file is stored in the byte order of the machine, all the fields are four bytes aligned)
+typedef struct {
+    char magic[4];          // "M7SC"
+    uint32_t version;       // M7_SCENE_VERSION
+    uint32_t elementCount;  // Number of element records
+    uint32_t textureCount;  // Number of texture references
+    float cellSize;         // Cell size of the spatial index enabled by M7_Scene_Instantiate() (0 for none)
+    uint32_t reserved[3];   // Zero
+} M7_SceneHeader;
+
+// Record of an element in a scene file, holding the world data of the element as given to the add functions
+typedef struct {
+    float position[2];      // 'onWorld.position' of the element
+    float scale[2];         // 'onWorld.scale' of the element
+    float rectangle[4];     // 'onWorld.rectangle' of the element (for textures the source rectangle, in pixels)
+    uint8_t tint[4];        // Tint color of the element
+    uint16_t type;          // M7_ZBT_TEXTURE, M7_ZBT_RECTANGLE or M7_ZBT_CIRCLE
+    uint16_t texture;       // Index of the texture reference of a texture element
+} M7_SceneRecord;
+
+typedef struct {
+    const M7_SceneHeader *header;   // Header of the scene (NULL if the file could not be loaded)
+    const char *names;              // Names of the texture references, M7_SCENE_NAME_SIZE bytes each
+    const M7_SceneRecord *records;  // Element records
+    void *data;                     // Content of the file, mapped or loaded
+    size_t size;                    // Size of the file (in bytes)
+    bool mapped;                    // Indicates that the file is mapped in memory rather than loaded
+} M7_Scene;
 
 /*
-    Main functions of the Mode 7 rendering module
+    Snapshot struct
 */
 
-// Load a Mode 7 camera with specified parameters
-M7_Camera M7_Camera_Load(int screenWidth, int screenHeight, Vector2 position, float rotation, float zoom, float fov, float offset, uint32_t maxSprites);
+#define M7_SNAPSHOT_FRESH 4 // Flag of the published buffer index, set until the buffer is taken by M7_Snapshot_Apply()
 
-// Unload a Mode 7 camera, freeing associated resources
-void M7_Camera_Unload(M7_Camera* camera);
+// Fields of an element written into a snapshot
+enum M7_Snapshot_Field {
+    M7_SNAPSHOT_POSITION = 1 << 0,  // 'onWorld.position'
+    M7_SNAPSHOT_SCALE = 1 << 1,     // 'onWorld.scale'
+    M7_SNAPSHOT_RECTANGLE = 1 << 2, // 'onWorld.rectangle' (for textures the source rectangle)
+    M7_SNAPSHOT_TINT = 1 << 3       // 'tint'
+};
 
-// Update the camera for rendering:
-// - For a single plane (simple update) with the provided texture, position, scale, wrap, and background color
-// - For multiple planes (advanced update) with the given background color
-void M7_Camera_Update(M7_Camera* camera, Texture2D texture, Vector2 position, Vector2 scale, int wrap, Color backgroundColor);
-void M7_Camera_Begin(M7_Camera* camera, Color backgroundColor);
-void M7_Camera_End(M7_Camera* camera);
+// World data of an element written into a snapshot, indexed by the slot of the element
+typedef struct {
+    M7_Handle handle;       // Element of the record (the record is skipped once the element has been removed)
+    uint32_t revision;      // Revision of the last write, the element is only modified when it has changed
+    uint32_t fields;        // Fields written since the element was given to the record (see M7_Snapshot_Field)
+    Vector2 position;       // 'onWorld.position' of the element
+    Vector2 scale;          // 'onWorld.scale' of the element
+    Rectangle rectangle;    // 'onWorld.rectangle' of the element
+    Color tint;             // Tint color of the element
+} M7_SnapshotRecord;
 
-// Render a plane (to be used in advanced mode) with the provided texture, position, origin, scale, and wrap
-void M7_Camera_DrawPlane(M7_Camera* camera, Texture2D texture, Vector2 position, Vector2 origin, Vector2 scale, int wrap);
+typedef struct {
+    M7_SnapshotRecord *records; // Records of the elements, indexed by slot
+    uint32_t count;             // Number of records (one past the highest slot written)
+    uint32_t capacity;          // Capacity of the records
+} M7_SnapshotBuffer;
 
-// Display the final rendered view from the camera
-void M7_Camera_Render(M7_Camera* camera);
+// Elements written on a simulation thread while the rendering thread applies the last published state (triple buffered)
+typedef struct {
+    M7_SnapshotBuffer buffers[3];   // The buffer written, the buffer published last and the buffer applied
+    int32_t shared;                 // Index of the buffer published last, with M7_SNAPSHOT_FRESH until taken (accessed atomically)
+    int back;                       // Index of the buffer written by the simulation thread
+    int front;                      // Index of the buffer applied by the rendering thread
+    uint32_t revision;              // Last revision given to a record, unique to each write (simulation thread)
+    uint32_t *applied;              // Revision of each record when it was last applied (rendering thread)
+    uint32_t appliedCapacity;       // Capacity of the applied revisions
+    bool pending;                   // Indicates that the front buffer has not been fully applied yet
+} M7_Snapshot;
 
-// Set camera properties:
-// - Position
-// - Rotation
+/*
+    Camera struct
+*/
+
+enum M7_Camera_State {
+    M7_STATE_RETAINED = 1 << 0,     // Only project again the elements marked as dirty or all of them when the camera has changed
+    M7_STATE_INSTANCING = 1 << 1,   // Draw the texture elements with one instanced draw call per run of elements sharing a texture
+    M7_STATE_DEPTH_BUFFER = 1 << 2, // Draw the opaque elements with the depth buffer in any order, only the translucent ones are sorted
+    M7_STATE_ROW_TABLE = 1 << 3     // Fetch the per-row terms of the plane projection from a table rebuilt when the camera changes
+};
+
+// Modulation of the plane projection on a row of the view, all zero for none (see M7_Camera_SetScanlines)
+typedef struct {
+    float rotation;     // Added to the rotation of the camera (in radians)
+    float zoom;         // Added to the zoom of the camera
+    float offset;       // Added to the offset of the camera
+    Vector2 scroll;     // Added to the position of the camera (in world units)
+} M7_Scanline;
+
+// Stages of the rendering measured with M7_STATS
+typedef enum {
+    M7_STAGE_PLANES,        // Plane, tilemap and virtual texture passes
+    M7_STAGE_UPDATE,        // Projection and visibility of the elements (M7_ZBuffer_Update())
+    M7_STAGE_SORT,          // Partition and sort of the rendering order (M7_ZBuffer_Sort())
+    M7_STAGE_DRAW,          // Draw of the elements (M7_ZBuffer_Draw())
+    M7_STAGE_COUNT
+} M7_Stage;
+
+// Measures of a frame of a camera (see M7_Camera_GetStats)
+typedef struct {
+    double cpuTime[M7_STAGE_COUNT]; // CPU time of each stage (in seconds)
+    double gpuTime[M7_STAGE_COUNT]; // GPU time of each stage from the latest results available, two frames old (in seconds, zero for the CPU only stages)
+    uint32_t planePasses;           // Number of plane passes drawn
+    uint32_t drawCalls;             // Number of draw calls issued by the module (plane passes, instanced runs and shapes flushed between the runs)
+    uint32_t batchedElements;       // Number of elements given to the raylib batch, drawn in as few draw calls as raylib needs
+    uint32_t updatedElements;       // Number of elements projected again
+    uint32_t drawnElements;         // Number of visible elements
+} M7_Stats;
+
+// Content of the 'M7_CameraBlock' uniform block of the plane shaders (std140 layout)
+typedef struct {
+    float camRot[8];        // Rotation matrix, one column per vec4
+    float fogColor[4];      // Fog color
+    float fogRange[2];      // Fog start and far distance
+    float targetSize[2];    // Size of the viewport (in pixels)
+    float offset;           // Offset
+    float zoom;             // Zoom
+    float fov;              // Field of view
+    float rowCount;         // Number of rows of the row table used
+    int useRowTable;        // Non-zero if the row table is used
+    int padding[3];
+} M7_CameraUniforms;
+
+// Uniform of a shader with the last value uploaded, which is only uploaded again when it changes
+typedef struct {
+    int loc;                // Location of the uniform
+    int type;               // ShaderUniformDataType of the uniform
+    uint8_t value[16];      // Last value uploaded
+    bool valid;             // Indicates that a value has been uploaded
+} M7_Uniform;
+
+// Shaders of the module, loaded with the first camera and shared by all the cameras
+// (the values of their uniforms are set by each camera before drawing)
+typedef struct M7_Programs {
+
+    struct { // An instance shared by all the cameras of the plane rendering shader
+
+        Shader shader;      // The shader used for rendering
+
+        int locMapTex;      // Location of the map texture uniform
+        int locRowTable;    // Location of the row table texture uniform
+
+        M7_Uniform mapSize; // Map size uniform
+        M7_Uniform camPos;  // Camera position uniform (in addition to the position and origin of the plane)
+        M7_Uniform wrap;    // Wrap uniform
+        M7_Uniform maxLod;  // Maximum LOD uniform
+
+    } planeProgram;
+
+    struct { // An instance shared by all the cameras of the tilemap rendering shader
+
+        Shader shader;      // The shader used for rendering
+
+        int locAtlasTex;    // Location of the atlas texture uniform
+        int locTilesTex;    // Location of the tile indices texture uniform
+        int locRowTable;    // Location of the row table texture uniform
+
+        M7_Uniform atlasSize;   // Atlas size uniform
+        M7_Uniform tileSize;    // Tile size uniform
+        M7_Uniform gridSize;    // Grid size uniform
+        M7_Uniform mapSize;     // Map size uniform
+        M7_Uniform camPos;      // Camera position uniform (in addition to the position and origin of the tilemap)
+        M7_Uniform wrap;        // Wrap uniform
+        M7_Uniform maxLod;      // Maximum LOD uniform
+
+    } tilemapProgram;
+
+    struct { // An instance shared by all the cameras of the virtual texture rendering shader
+
+        Shader shader;      // The shader used for rendering
+
+        int locCacheTex;    // Location of the page cache texture uniform
+        int locPageTable;   // Location of the page table texture uniform
+        int locRowTable;    // Location of the row table texture uniform
+
+        M7_Uniform mapTexels;   // Map size in pixels uniform
+        M7_Uniform pageSize;    // Page size uniform
+        M7_Uniform fallback;    // Fallback color uniform
+        M7_Uniform mapSize;     // Map size uniform
+        M7_Uniform camPos;      // Camera position uniform (in addition to the position and origin of the map)
+        M7_Uniform wrap;        // Wrap uniform
+
+    } virtualProgram;
+
+    struct { // An instance shared by all the cameras of the instanced sprite rendering shader
+
+        Shader shader;      // The shader used for rendering
+
+        int locTargetSize;  // Location of the render target size uniform
+        int locTexSize;     // Location of the texture size uniform
+
+        int locCamPos;      // Location of the camera position uniform
+        int locCamRot;      // Location of the camera rotation uniform
+
+        int locZoom;        // Location of the zoom uniform
+        int locFOV;         // Location of the field of view uniform
+        int locOffset;      // Location of the offset uniform
+        int locAlphaCutoff; // Location of the alpha cutoff uniform
+
+    } spriteProgram;
+
+    struct { // An instance shared by all the cameras of the alpha tested shader for the opaque elements drawn with raylib
+
+        Shader shader;      // The shader used for rendering
+        int locAlphaCutoff; // Location of the alpha cutoff uniform
+
+    } alphaTestProgram;
+
+    struct { // An instance shared by all the cameras of the shader writing the identifiers of the picked elements
+
+        Shader shader;      // The shader used for rendering
+        int locAlphaCutoff; // Location of the alpha cutoff uniform
+
+    } pickProgram;
+
+    uint32_t refCount;      // Number of cameras using the shaders
+
+} M7_Programs;
+
+// Job run by the parallel for callback on the batches [first, first + count) of the range it was given
+typedef void (*M7_Job)(void* data, uint32_t first, uint32_t count);
+
+// Callback running a job over the range [0, count), split in any number of calls on any threads,
+// and returning once all the calls have completed (see M7_Camera_SetParallelFor)
+typedef void (*M7_ParallelFor)(M7_Job job, void* data, uint32_t count, void* userData);
+
+typedef struct M7_Camera {
+
+    M7_Programs *programs;  // The shaders, shared by all the cameras
+
+    struct { // Camera parameters shared by the plane shaders through the 'M7_CameraBlock' uniform block
+
+        unsigned int ubo;       // Uniform buffer of the block
+        M7_CameraUniforms data; // Content of the block
+        bool dirty;             // Indicates that the content has changed since the last upload
+
+    } uniforms;
+
+    struct { // Instance buffers of the instanced sprite rendering
+
+        unsigned int vao;   // Vertex array describing the instance attributes
+        unsigned int vbo;   // Buffer of the instance attributes
+
+        M7_SpriteInstance *instances;   // Instance attributes of the frame, in rendering order
+        uint32_t capacity;              // Capacity of the instance buffers (in instances)
+
+    } spriteBatch;
+
+    struct { // Terms of the plane projection that are constant along each row of the target (see M7_STATE_ROW_TABLE)
+
+        Texture2D texture;  // Start and step of each row in camera space (RGBA32F, one texel per row of the target)
+        float *rows;        // Copy of the texture data, rebuilt on the CPU
+        M7_Scanline *scanlines; // Modulation of the terms of each row (NULL for none, see M7_Camera_SetScanlines)
+        int scanlineCount;      // Number of scanlines, spread over the rows of the viewport
+        bool dirty;         // Indicates that the rotation, zoom, FOV, offset or scanlines have changed since the last upload
+
+    } rowTable;
+
+    RenderTexture target;   // The render target (only its size is set with the software backend)
+
+    struct { // Screen cells of the draw list, binned on the first pick after each frame (see M7_Camera_Pick)
+
+        uint32_t *cellStart;    // First entry of each cell, followed by the end of the last cell
+        uint32_t *entries;      // Positions in the draw list of the elements overlapping each cell
+        uint32_t capacity;      // Capacity of the entries
+        int columns;            // Number of cells across the target
+        int rows;               // Number of cells down the target
+        bool valid;             // Indicates that the cells match the draw list of the last frame
+        RenderTexture target;   // Target of a single pixel in which the identifiers are drawn (loaded on first use)
+
+    } pick;
+
+    struct { // View rendered on the CPU instead of the render target (see M7_Camera_LoadSoftware)
+
+        Image image;        // Pixels of the view (RGBA8, size of the target, the view is in its top left corner with a resolution scale)
+        bool enabled;       // Indicates that the camera renders with the software backend, no GL object is created then
+
+    } software;
+
+    M7_World *world;        // The elements rendered by the camera, possibly shared with other cameras
+    M7_ZBuffer_View *view;  // Projection and rendering order of the elements by the camera
+
+    Matrix2x2 rotMat;       // Rotation matrix
+    Vector2 position;       // Camera position
+
+    float rotation;         // Camera rotation
+    float zoom;             // Camera zoom
+    float fov;              // Field of view
+    float offset;           // Offset
+    float farDistance;      // World distance in front of the camera beyond which the elements are not drawn (0 for no limit)
+    float fogStart;         // World distance from which the planes are blended with the fog color, up to the far distance
+    Color fogColor;         // Color of the planes beyond the far distance (transparent by default)
+    float maxLod;           // Highest mipmap level sampled on the planes
+
+    float aspect;           // RenderTexture aspect ratio
+
+    float resolutionScale;  // Fraction of the size of the target at which the view is rendered, then upscaled by M7_Camera_Render()
+    float frameBudget;      // Frame time held by adjusting the resolution scale (in seconds, 0 for a fixed scale)
+    float minResolutionScale; // Lowest resolution scale reached by the frame budget
+    float frameTime;        // Smoothed frame time measured for the frame budget (in seconds)
+
+    uint32_t version;       // Incremented each time a camera parameter changes (used by the retained mode)
+    unsigned int state;     // Combination of M7_Camera_State flags
+
+    M7_ParallelFor parallelFor; // Callback used to update the elements on several threads (NULL to update them on the calling thread)
+    void *parallelData;         // User data given to the parallel for callback
+
+#ifdef M7_STATS
+    struct { // Measures of the rendering stages (see M7_Camera_GetStats)
+
+        M7_Stats frame;             // Measures of the frame being rendered
+        M7_Stats last;              // Measures of the last completed frame
+        unsigned int queries[2][3]; // Timestamps of the start of the planes, of the draw and of its end, one set per frame in flight
+        bool pending[2];            // Indicates that a set of timestamps has been issued and not read yet
+        int index;                  // Set of timestamps used by the current frame
+
+    } stats;
+#endif
+
+} M7_Camera;
+
+// Camera terms of M7_ToScreen() and M7_ToWorld() computed once for the batch conversions
+typedef struct {
+    float camX, camY;       // Camera position
+    float spaceXX, spaceXY; // Factors of the world offset giving the horizontal camera space coordinate
+    float spaceYX, spaceYY; // Factors of the world offset giving the depth camera space coordinate
+    float screenScaleX;     // Offset times the target width
+    float screenScaleY;     // Target height
+    float halfWidth;        // Half of the target width
+    float sizeScale;        // Offset times the target width divided by the zoom
+    float offsetMinusOne;   // Offset minus one
+    float offsetHeight;     // Offset times the target height
+    float worldScaleX;      // Zoom divided by the aspect ratio
+    float worldScaleY;      // Zoom divided by the field of view
+    Matrix2x2 rotMat;       // Camera rotation matrix
+} M7_Projection;
+
+// Data of the software rendering jobs, each batch covers M7_SOFTWARE_BATCH_ROWS rows of the pass
+typedef struct {
+    const M7_Camera *camera;
+    const Image *map;       // Pixels of the plane (NULL for the elements pass)
+    float mapSize[2];       // World size of the plane
+    float camPos[2];        // Camera position in addition to the position and origin of the plane
+    int wrap;               // Wrap mode of the plane
+    int x0, x1;             // Columns of the viewport covered by the pass
+    int y0, y1;             // Rows of the viewport covered by the pass
+    int width, height;      // Size of the viewport (in pixels)
+} M7_SoftwareData;
+
+/*
+    Main functions of the Mode 7 rendering module
+*/
+
+// Load a Mode 7 camera with specified parameters (its 'world' is NULL if an allocation failed)
+M7_Camera M7_Camera_Load(int screenWidth, int screenHeight, Vector2 position, float rotation, float zoom, float fov, float offset, uint32_t maxSprites);
+
+// Unload a Mode 7 camera, freeing associated resources
+void M7_Camera_Unload(M7_Camera* camera);
+
+// Update the camera for rendering:
+// - For a single plane (simple update) with the provided texture, position, scale, wrap, and background color
+// - For multiple planes (advanced update) with the given background color
+void M7_Camera_Update(M7_Camera* camera, Texture2D texture, Vector2 position, Vector2 scale, int wrap, Color backgroundColor);
+void M7_Camera_Begin(M7_Camera* camera, Color backgroundColor);
+void M7_Camera_End(M7_Camera* camera);
+
+// Render a plane (to be used in advanced mode) with the provided texture, position, origin, scale, and wrap
+void M7_Camera_DrawPlane(M7_Camera* camera, Texture2D texture, Vector2 position, Vector2 origin, Vector2 scale, int wrap);
+
+// Render a tilemap (to be used in advanced mode) with the provided tilemap, position, origin, scale, and wrap
+// All the tiles of the map are rendered in a single pass, unlike a call to M7_Camera_DrawPlane() per tile
+void M7_Camera_DrawTilemap(M7_Camera* camera, M7_Tilemap* tilemap, Vector2 position, Vector2 origin, Vector2 scale, int wrap);
+
+// Render a virtual texture (to be used in advanced mode) with the provided position, origin, scale, and wrap
+// The missing pages under the view are requested through the callback of the texture, the nearest ones first
+void M7_Camera_DrawVirtualTexture(M7_Camera* camera, M7_VirtualTexture* texture, Vector2 position, Vector2 origin, Vector2 scale, int wrap);
+
+// Display the final rendered view from the camera
+void M7_Camera_Render(M7_Camera* camera);
+
+// Set camera properties:
+// - Position
+// - Rotation
 // - Zoom
 // - Field of View (FOV)
 // - Offset
@@ -186,6 +1203,54 @@ void M7_Camera_SetZoom(M7_Camera* camera, float zoom);
 void M7_Camera_SetFOV(M7_Camera* camera, float fov);
 void M7_Camera_SetOffset(M7_Camera* camera, float offset);
 
+// Set the fraction of the target size at which the view is rendered, then upscaled by M7_Camera_Render(),
+// or the frame time to hold by adjusting this fraction on each frame down to a minimum (0 to disable)
+void M7_Camera_SetResolutionScale(M7_Camera* camera, float scale);
+void M7_Camera_SetFrameBudget(M7_Camera* camera, float budget, float minScale);
+
+// Set, clear or check camera state flags (see M7_Camera_State)
+void M7_Camera_SetState(M7_Camera* camera, unsigned int flags);
+void M7_Camera_ClearState(M7_Camera* camera, unsigned int flags);
+bool M7_Camera_IsState(const M7_Camera* camera, unsigned int flag);
+
+// Set the sort strategy used for the elements and get the sort path that ran on the last frame
+// (can be used in profiles to check which path is taken)
+void M7_Camera_SetSortMode(M7_Camera* camera, M7_SortMode mode);
+M7_SortMode M7_Camera_GetSortPath(const M7_Camera* camera);
+
+// Set the callback used to spread the update and the visibility test of the elements over worker threads
+// (the sort and the draw calls stay on the calling thread, pass NULL to go back to a single thread)
+void M7_Camera_SetParallelFor(M7_Camera* camera, M7_ParallelFor parallelFor, void* userData);
+
+// Set the distance in front of the camera beyond which the elements are not drawn (0 for no limit)
+void M7_Camera_SetFarDistance(M7_Camera* camera, float distance);
+
+// Set the fog color of the planes, used beyond the far distance and blended from the start distance,
+// and the highest mipmap level sampled on the planes (the level of each row is derived from its distance)
+void M7_Camera_SetFog(M7_Camera* camera, Color color, float start);
+void M7_Camera_SetMaxLOD(M7_Camera* camera, float lod);
+
+// Set the modulation of the plane projection on each row of the view, from the top (NULL to remove it),
+// baked into the row table so that curved horizons, wobbles or tunnels cost the same single pass as a plain plane
+bool M7_Camera_SetScanlines(M7_Camera* camera, const M7_Scanline* scanlines, int count);
+
+// Get the measures of the last completed frame and draw them as text lines (requires M7_STATS)
+const M7_Stats* M7_Camera_GetStats(const M7_Camera* camera);
+void M7_Camera_DrawStats(const M7_Camera* camera, int x, int y, int fontSize, Color color);
+
+// Enable or disable the spatial index of the elements, with which only the elements of the cells under
+// the view of the camera are updated (requires a far distance, the whole world is updated without it)
+bool M7_Camera_EnableSpatialIndex(M7_Camera* camera, float cellSize);
+void M7_Camera_DisableSpatialIndex(M7_Camera* camera);
+
+// Render the elements of another camera instead of its own ones (e.g. for split-screen views),
+// the elements are added once and can then be added, removed or modified through any of these cameras
+bool M7_Camera_ShareWorld(M7_Camera* camera, const M7_Camera* source);
+
+// Get the screen rectangle, position and distance with which an element was last projected by the camera
+// (any output can be NULL, false if the element is not in the world of the camera or has not been projected yet)
+bool M7_Camera_GetElementScreen(const M7_Camera* camera, const M7_Element* elem, Rectangle* rect, Vector2* position, float* distance);
+
 // Perform camera transformations:
 // - Translation (dx, dy)
 // - Rotation (delta)
@@ -198,6 +1263,19 @@ void M7_Camera_Move(M7_Camera* camera, float speed);
 Vector3 M7_ToScreen(M7_Camera* camera, Vector2 point);
 Vector2 M7_ToWorld(M7_Camera* camera, Vector2 point);
 
+// Convert arrays of coordinates between world and screen space
+// (same results as above, with SIMD kernels when available)
+void M7_ToScreenN(M7_Camera* camera, const Vector2* points, Vector3* out, size_t count);
+void M7_ToWorldN(M7_Camera* camera, const Vector2* points, Vector2* out, size_t count);
+
+// Get the front-most element drawn by the last frame at screen coordinates (NULL if none):
+// - From the screen bounds of the elements, binned on the first pick after each frame
+// - The same for an array of coordinates
+// - Pixel exact, the texels below M7_PICK_ALPHA_CUTOFF are not hit (reads a pixel back, not between Begin and End)
+M7_Element* M7_Camera_Pick(M7_Camera* camera, Vector2 point);
+void M7_Camera_PickN(M7_Camera* camera, const Vector2* points, M7_Element** out, size_t count);
+M7_Element* M7_Camera_PickPixel(M7_Camera* camera, Vector2 point);
+
 // Functions for adding elements to the world display:
 // - Texture
 // - Rectangle
@@ -206,660 +1284,6833 @@ M7_Element* M7_Texture_Add(M7_Camera* camera, Texture2D texture, Rectangle sourc
 M7_Element* M7_Rectangle_Add(M7_Camera* camera, Rectangle rectangle, Color tint);
 M7_Element* M7_Circle_Add(M7_Camera* camera, Vector2 position, float radius, Color tint);
 
+// Functions for removing elements and referencing them with handles:
+// - Remove an element, its slot can then be reused by a new element
+// - Get the handle of an element
+// - Get the element referenced by a handle (NULL if the element has been removed)
+bool M7_Element_Remove(M7_Camera* camera, M7_Element* elem);
+M7_Handle M7_Element_GetHandle(const M7_Element* elem);
+M7_Element* M7_Element_FromHandle(M7_Camera* camera, M7_Handle handle);
+
+// Functions for modifying an element, marking it as dirty for the retained mode:
+// - Position
+// - Scale
+// - Mark as dirty (to call after modifying the fields of an element directly)
+void M7_Element_SetPosition(M7_Element* elem, Vector2 position);
+void M7_Element_SetScale(M7_Element* elem, Vector2 scale);
+void M7_Element_MarkDirty(M7_Element* elem);
+
+// Functions for managing tilemaps:
+// - Load a tilemap from an atlas, the tile size and the map size (in tiles), 'tiles' can be NULL for an empty map
+// - Unload a tilemap
+// - Set / Get the atlas tile index of a map tile (-1 for an empty tile)
+M7_Tilemap M7_Tilemap_Load(Texture2D atlas, int tileWidth, int tileHeight, int width, int height, const int* tiles);
+void M7_Tilemap_Unload(M7_Tilemap* tilemap);
+void M7_Tilemap_SetTile(M7_Tilemap* tilemap, int x, int y, int tile);
+int M7_Tilemap_GetTile(const M7_Tilemap* tilemap, int x, int y);
+
+// Functions for managing sprite atlases, into which the textures of the elements are packed so that they are drawn in a single batch:
+// - Load an atlas from the textures of the elements of a camera and make these elements use it
+// - Unload an atlas (the elements using it must be removed or given another texture before)
+// - Make the elements of a camera using one of the packed textures use the atlas instead (returns the number of modified elements)
+M7_SpriteAtlas M7_SpriteAtlas_Load(M7_Camera* camera, int padding);
+void M7_SpriteAtlas_Unload(M7_SpriteAtlas* atlas);
+int M7_SpriteAtlas_Apply(const M7_SpriteAtlas* atlas, M7_Camera* camera);
+
+// Functions for managing virtual textures, maps larger than the texture limits whose pages are streamed in a cache:
+// - Load a virtual texture from the size of the map, of its pages and of the cache (in pages), and the callback requesting the pages
+// - Unload a virtual texture
+// - Submit the pixels of a requested page (NULL if it could not be loaded, it will be requested again,
+//   as it is when the cache is full of pages under the view)
+M7_VirtualTexture M7_VirtualTexture_Load(int width, int height, int pageSize, int cacheColumns, int cacheRows, M7_PageRequest request, void* userData);
+void M7_VirtualTexture_Unload(M7_VirtualTexture* texture);
+bool M7_VirtualTexture_SubmitPage(M7_VirtualTexture* texture, int pageX, int pageY, const void* pixels);
+
+// Functions for loading textures asynchronously, decoded on worker threads and uploaded in slices on the rendering thread:
+// - Load a loader from its upload budget per update (0 for the default) and the callback requesting the decoding (NULL to decode on the rendering thread)
+// - Unload a loader and all the textures of its assets (no asset must be being decoded)
+// - Add an asset, whose 'texture' can be drawn right away (it is a placeholder of a single texel until the asset is ready)
+// - Decode the pixels of a requested asset (can be called from any thread)
+// - Submit a decoded asset, to call on the rendering thread once M7_Asset_Decode() has returned (false if the asset is not of the loader or not being decoded)
+// - Request, upload and complete the assets within the budget, to call once per frame (returns the number of assets that became ready)
+// - Make the elements of a camera using the placeholder of a ready asset use its texture (returns the number of modified elements)
+// - Check whether all the assets are ready or have failed
+M7_Loader M7_Loader_Load(size_t uploadBudget, M7_AssetRequest request, void* userData);
+void M7_Loader_Unload(M7_Loader* loader);
+M7_Asset* M7_Loader_Add(M7_Loader* loader, const char* fileName, bool mipmaps);
+bool M7_Asset_Decode(M7_Asset* asset);
+bool M7_Loader_Submit(M7_Loader* loader, M7_Asset* asset);
+int M7_Loader_Update(M7_Loader* loader);
+int M7_Loader_Apply(const M7_Loader* loader, M7_Camera* camera);
+bool M7_Loader_IsDone(const M7_Loader* loader);
+
+// Functions for managing scene files, holding the elements of a world that are added in bulk without parsing:
+// - Load a scene file, memory mapped when available (the header is NULL if the file could not be loaded or is invalid)
+// - Unload a scene file (the elements added from it are not removed)
+// - Get the name of a texture reference of a scene (NULL if the index is out of the scene)
+// - Add all the elements of a scene to a camera, 'textures' giving the texture of each reference (returns the number of added elements)
+// - Save the elements of a camera into a scene file, the texture elements whose texture is not in 'textures' are skipped
+M7_Scene M7_Scene_Load(const char* fileName);
+void M7_Scene_Unload(M7_Scene* scene);
+const char* M7_Scene_GetTextureName(const M7_Scene* scene, int index);
+uint32_t M7_Scene_Instantiate(const M7_Scene* scene, M7_Camera* camera, const Texture2D* textures);
+bool M7_Scene_Export(const char* fileName, M7_Camera* camera, const Texture2D* textures, const char** names, int textureCount, float cellSize);
+
+// Functions for modifying the elements from a simulation thread while the rendering thread draws the previous frame:
+// - Load a snapshot from the number of element slots to reserve (it grows when needed)
+// - Unload a snapshot
+// - Set the position, scale, rectangle or tint of the element of a handle (simulation thread, false if an allocation failed)
+// - Publish the state written so far, to call at the end of each simulation step (simulation thread)
+// - Apply the state published last to the elements of a camera, before M7_Camera_End() (rendering thread, returns the number of modified elements)
+M7_Snapshot M7_Snapshot_Load(uint32_t capacity);
+void M7_Snapshot_Unload(M7_Snapshot* snapshot);
+bool M7_Snapshot_SetPosition(M7_Snapshot* snapshot, M7_Handle handle, Vector2 position);
+bool M7_Snapshot_SetScale(M7_Snapshot* snapshot, M7_Handle handle, Vector2 scale);
+bool M7_Snapshot_SetRectangle(M7_Snapshot* snapshot, M7_Handle handle, Rectangle rectangle);
+bool M7_Snapshot_SetTint(M7_Snapshot* snapshot, M7_Handle handle, Color tint);
+void M7_Snapshot_Publish(M7_Snapshot* snapshot);
+uint32_t M7_Snapshot_Apply(M7_Snapshot* snapshot, M7_Camera* camera);
+
+// Functions of the software backend, which renders the view into an image on the CPU without any GL object:
+// - Load a camera rendering into 'camera.software.image' between M7_Camera_Begin() and M7_Camera_End()
+// - Draw a plane from the pixels of an image (RGBA8, the GL draw functions do nothing on these cameras)
+// - Add a texture element from the pixels of an image (RGBA8, kept by pointer, only drawn by the software backend)
+M7_Camera M7_Camera_LoadSoftware(int screenWidth, int screenHeight, Vector2 position, float rotation, float zoom, float fov, float offset, uint32_t maxSprites);
+void M7_Camera_DrawPlaneImage(M7_Camera* camera, const Image* image, Vector2 position, Vector2 origin, Vector2 scale, int wrap);
+M7_Element* M7_Image_Add(M7_Camera* camera, const Image* image, Rectangle source, Vector2 position, Vector2 scale, Color tint);
+
 /*
     IMPLEMENTATION
 */
 
 #ifdef M7_IMPL
 
+// Memory mapping of the scene files, only included with the implementation
+// (define M7_NO_MMAP to always read them into memory)
+#if !defined(M7_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   define M7_SCENE_MMAP
+#endif
+
+/*
+    Instrumentation of the rendering stages (compiled out without M7_STATS)
+*/
+
+#ifdef M7_STATS
+#   define M7_STATS_TIME(name) const double name = GetTime()
+#   define M7_STATS_ADD(camera, stage, start) ((camera)->stats.frame.cpuTime[stage] += GetTime() - (start))
+#   define M7_STATS_COUNT(camera, counter, n) ((camera)->stats.frame.counter += (n))
+#   define M7_STATS_BEGIN_FRAME(camera) M7_Stats_BeginFrame(camera)
+#   define M7_STATS_TIMESTAMP(camera, query) M7_Stats_Timestamp(camera, query)
+#   define M7_STATS_END_FRAME(camera) M7_Stats_EndFrame(camera)
+#else
+#   define M7_STATS_TIME(name)
+#   define M7_STATS_ADD(camera, stage, start) ((void)0)
+#   define M7_STATS_COUNT(camera, counter, n) ((void)0)
+#   define M7_STATS_BEGIN_FRAME(camera) ((void)0)
+#   define M7_STATS_TIMESTAMP(camera, query) ((void)0)
+#   define M7_STATS_END_FRAME(camera) ((void)0)
+#endif
+
 /*
     Static function pre-declarations (private)
 */
 
-static M7_ZBuffer M7_ZBuffer_Load(uint32_t maxElements);
+static float M7_Camera_GetDepth(M7_Camera* camera, Vector2 point);
+static bool M7_Camera_GetPlaneBounds(M7_Camera* camera, Rectangle area, Rectangle* bounds);
+static bool M7_Camera_ClipFarRows(M7_Camera* camera, Rectangle* bounds);
+static void M7_Camera_DrawPlaneQuad(M7_Camera* camera, Rectangle bounds);
+static void M7_Camera_GetRowTerms(const M7_Camera* camera, int row, int height, float* terms);
+static void M7_Camera_UpdateRowTable(M7_Camera* camera);
+static void M7_Camera_GetViewport(const M7_Camera* camera, int* width, int* height);
+static void M7_Camera_ApplyResolutionScale(M7_Camera* camera, float scale);
+
+#ifdef M7_STATS
+static void M7_Stats_BeginFrame(M7_Camera* camera);
+static void M7_Stats_Timestamp(M7_Camera* camera, int query);
+static void M7_Stats_EndFrame(M7_Camera* camera);
+#endif
+
+static M7_Programs* M7_Programs_Acquire(void);
+static void M7_Programs_Release(M7_Programs* programs);
+
+static M7_Uniform M7_Uniform_Get(Shader shader, const char* name, int type);
+static void M7_Uniform_Set(Shader shader, M7_Uniform* uniform, const void* value);
+static void M7_Shader_BindCameraBlock(Shader shader);
+static void M7_Camera_UseUniforms(M7_Camera* camera);
+
+static M7_Projection M7_Camera_GetProjection(const M7_Camera* camera);
+static size_t M7_ToScreen_SIMD(const M7_Projection* proj, const Vector2* points, Vector3* out, size_t count);
+static size_t M7_ToWorld_SIMD(const M7_Projection* proj, const Vector2* points, Vector2* out, size_t count);
+
+static bool M7_Camera_GetViewTrapezoid(const M7_Camera* camera, float extentX, float extentY, Vector2 corners[4]);
+static bool M7_Polygon_GetRowSpan(const Vector2* points, int count, float y0, float y1, float* x0, float* x1);
+
+static int M7_SpriteAtlas_Compare(const void* a, const void* b);
+static int M7_SpriteAtlas_Pack(M7_SpriteAtlas_Entry* entries, int count, int width, int padding);
+
+static bool M7_Snapshot_Reserve(M7_SnapshotBuffer* buffer, uint32_t count);
+static M7_SnapshotRecord* M7_Snapshot_Write(M7_Snapshot* snapshot, M7_Handle handle, uint32_t field);
+
+static uint32_t M7_SpatialIndex_GetBucket(int32_t x, int32_t y);
+static M7_SpatialIndex* M7_SpatialIndex_Load(float cellSize, uint32_t capacity);
+static void M7_SpatialIndex_Unload(M7_SpatialIndex* grid);
+static bool M7_SpatialIndex_Grow(M7_SpatialIndex* grid, uint32_t capacity);
+static void M7_SpatialIndex_Insert(M7_SpatialIndex* grid, const M7_ZBuffer_Element* elem);
+static void M7_SpatialIndex_Remove(M7_SpatialIndex* grid, uint32_t slot);
+static void M7_SpatialIndex_Update(M7_SpatialIndex* grid, M7_ZBuffer* buffer);
+static bool M7_SpatialIndex_Query(M7_SpatialIndex* grid, M7_ZBuffer* buffer, const M7_Camera* camera);
+
+static int M7_VirtualTexture_Compare(const void* a, const void* b);
+static void M7_VirtualTexture_Feedback(M7_VirtualTexture* texture, M7_Camera* camera, Vector2 position, Vector2 scale, int wrap);
+
+static size_t M7_Loader_Upload(M7_Loader* loader, M7_Asset* asset, size_t budget);
+
+static void M7_Software_Blend(unsigned char* dst, Color src);
+static void M7_Software_Shade(unsigned char* dst, const unsigned char* texel, int fog, Color fogColor);
+static void M7_Software_Clear(M7_Camera* camera, Color color);
+static void M7_Software_PlaneJob(void* data, uint32_t first, uint32_t count);
+static void M7_Software_ElementsJob(void* data, uint32_t first, uint32_t count);
+static void M7_Software_DrawElements(M7_Camera* camera);
+
+static void M7_Pick_GetCells(const M7_Camera* camera, const M7_ZBuffer_Element* elem, int* cx0, int* cy0, int* cx1, int* cy1);
+static bool M7_Pick_Build(M7_Camera* camera);
+static const uint32_t* M7_Pick_GetCell(M7_Camera* camera, Vector2 point, uint32_t* count);
+
+static M7_World* M7_World_Load(uint32_t capacity);
+static void M7_World_Release(M7_World* world);
+
+static M7_ZBuffer M7_ZBuffer_Load(uint32_t capacity);
 static void M7_ZBuffer_Unload(M7_ZBuffer* buffer);
+static bool M7_ZBuffer_Grow(M7_ZBuffer* buffer, uint32_t chunkCount);
+
+static M7_ZBuffer_View* M7_ZBuffer_View_Load(M7_ZBuffer* buffer);
+static void M7_ZBuffer_View_Unload(M7_ZBuffer* buffer, M7_ZBuffer_View* view);
+static bool M7_ZBuffer_View_Grow(M7_ZBuffer_View* view, uint32_t capacity, uint32_t count);
 
 static M7_ZBuffer_Element* M7_ZBuffer_Element_Add(M7_ZBuffer* buffer, M7_ZBuffer_Element* elem);
+static bool M7_ZBuffer_Element_Remove(M7_ZBuffer* buffer, M7_ZBuffer_Element* elem);
+static M7_ZBuffer_Element* M7_ZBuffer_Element_Get(M7_ZBuffer* buffer, uint32_t slot);
+
+static void M7_ZBuffer_Element_Sync(M7_ZBuffer* buffer, const M7_ZBuffer_Element* elem);
+static void M7_ZBuffer_Element_Update(M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem);
+static bool M7_ZBuffer_Element_IsVisible(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem, float width, float height, float minDistance);
+static void M7_ZBuffer_Element_GetBounds(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem, float* x0, float* y0, float* x1, float* y1);
+static bool M7_ZBuffer_Element_Contains(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem, Vector2 point);
+static void M7_ZBuffer_Element_Touch(M7_ZBuffer_Element* elem);
+static void M7_ZBuffer_Element_Draw(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem);
+static float M7_ZBuffer_Element_GetDepth(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem);
+static void M7_ZBuffer_Element_DrawDepth(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem);
+
+static int M7_ZBuffer_Compare(const void* a, const void* b);
+static bool M7_ZBuffer_InsertionSort(M7_ZBuffer_View* view, uint32_t count, uint32_t maxMoves);
+static void M7_ZBuffer_RadixSort(M7_ZBuffer_View* view, uint32_t count);
+static void M7_ZBuffer_Sort(M7_ZBuffer_View* view, uint32_t count);
+static bool M7_ZBuffer_Partition(const M7_ZBuffer* buffer, M7_ZBuffer_View* view);
+static void M7_ZBuffer_Cull(const M7_ZBuffer* buffer, M7_ZBuffer_View* view);
+static void M7_ZBuffer_CullCandidates(const M7_ZBuffer* buffer, M7_ZBuffer_View* view);
+static void M7_ZBuffer_SwapOrder(M7_ZBuffer_View* view, uint32_t a, uint32_t b);
+
+static void M7_ZBuffer_Project(const M7_ZBuffer* buffer, M7_ZBuffer_View* view, const M7_Camera* camera, uint32_t first, uint32_t count);
+static void M7_ZBuffer_UpdateJob(void* data, uint32_t first, uint32_t count);
+static void M7_ZBuffer_UpdateKeysJob(void* data, uint32_t first, uint32_t count);
+static void M7_Camera_ParallelFor(M7_Camera* camera, M7_Job job, void* data, uint32_t count);
+static uint32_t M7_ZBuffer_Update(M7_Camera* camera);
+static void M7_ZBuffer_DrawRun(M7_Camera* camera, Texture2D texture, uint32_t first, uint32_t count);
+static void M7_ZBuffer_DrawInstanced(M7_Camera* camera, const M7_ZBuffer_SortKey* order, uint32_t count, float alphaCutoff);
+static void M7_ZBuffer_DrawDepth(M7_Camera* camera);
+static void M7_ZBuffer_Draw(M7_Camera* camera);
+
+/*
+    Camera system functions
+*/
+
+/**
+ * Load a Mode 7 camera with specified parameters.
+ *
+ * @param screenWidth The screen width.
+ * @param screenHeight The screen height.
+ * @param position The camera's initial position.
+ * @param rotation The camera's initial rotation.
+ * @param zoom The camera's initial zoom.
+ * @param fov The camera's initial field of view.
+ * @param offset The camera's initial offset.
+ * @param maxSprites The initial capacity of the ZBuffer (it grows by chunks when needed).
+ *
+ * @return The initialized Mode 7 camera, with NULL 'programs' and 'world' if an allocation failed.
+ */
+M7_Camera M7_Camera_Load(int screenWidth, int screenHeight, Vector2 position, float rotation, float zoom, float fov, float offset, uint32_t maxSprites)
+{
+    M7_Camera camera = {0};
+
+    camera.aspect = (screenWidth > screenHeight)
+        ? ((float)screenWidth / (float)screenHeight)
+        : ((float)screenHeight / (float)screenWidth);
+
+    camera.programs = M7_Programs_Acquire();
+
+    // Nothing could be drawn without the shaders, so no other resource is created
+
+    if (!camera.programs) return (M7_Camera) {0};
+
+    camera.world = M7_World_Load(maxSprites);
+    camera.view = camera.world ? M7_ZBuffer_View_Load(&camera.world->buffer) : NULL;
+
+    if (!camera.view)
+    {
+        M7_World_Release(camera.world);
+        M7_Programs_Release(camera.programs);
+        return (M7_Camera) {0};
+    }
+
+    glGenBuffers(1, &camera.uniforms.ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, camera.uniforms.ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(M7_CameraUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    camera.uniforms.dirty = true;
+
+    glGenVertexArrays(1, &camera.spriteBatch.vao);
+    glGenBuffers(1, &camera.spriteBatch.vbo);
+
+#ifdef M7_STATS
+    glGenQueries(6, &camera.stats.queries[0][0]);
+#endif
+
+    camera.target = LoadRenderTexture(screenWidth, screenHeight);
+
+    // One texel per row of the target, the table is only filled once M7_STATE_ROW_TABLE is set
+
+    camera.rowTable.rows = (float*)calloc(4 * screenHeight, sizeof(float));
+
+    camera.rowTable.texture = (Texture2D) {
+        .id = rlLoadTexture(camera.rowTable.rows, screenHeight, 1, PIXELFORMAT_UNCOMPRESSED_R32G32B32A32, 1),
+        .width = screenHeight, .height = 1, .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R32G32B32A32
+    };
+
+    camera.rowTable.dirty = true;
+
+    M7_Camera_ApplyResolutionScale(&camera, 1.0f);
+
+    camera.maxLod = M7_MAX_LOD;
+    camera.fogStart = INFINITY;
+    M7_Camera_SetFog(&camera, BLANK, INFINITY);
+
+    M7_Camera_SetPosition(&camera, position);
+    M7_Camera_SetRotation(&camera, rotation);
+    M7_Camera_SetOffset(&camera, offset);
+    M7_Camera_SetZoom(&camera, zoom);
+    M7_Camera_SetFOV(&camera, fov);
+
+    return camera;
+}
+
+/**
+ * Unload a Mode 7 camera, freeing associated resources.
+ *
+ * @param camera The camera to be unloaded.
+ */
+void M7_Camera_Unload(M7_Camera* camera)
+{
+    free(camera->pick.cellStart);
+    free(camera->pick.entries);
+    camera->pick.cellStart = camera->pick.entries = NULL;
+    camera->pick.capacity = 0;
+    camera->pick.valid = false;
+
+    if (camera->pick.target.id > 0)
+    {
+        UnloadRenderTexture(camera->pick.target);
+        camera->pick.target = (RenderTexture) {0};
+    }
+
+    if (camera->rowTable.scanlines)
+    {
+        free(camera->rowTable.scanlines);
+        camera->rowTable.scanlines = NULL;
+        camera->rowTable.scanlineCount = 0;
+    }
+
+    if (camera->view)
+    {
+        M7_ZBuffer_View_Unload(&camera->world->buffer, camera->view);
+        camera->view = NULL;
+    }
+
+    if (camera->software.enabled)
+    {
+        M7_World_Release(camera->world);
+        camera->world = NULL;
+
+        free(camera->software.image.data);
+        camera->software.image.data = NULL;
+        camera->software.enabled = false;
+
+        return;
+    }
+
+    M7_Programs_Release(camera->programs);
+    camera->programs = NULL;
+
+    UnloadRenderTexture(camera->target);
+    UnloadTexture(camera->rowTable.texture);
+    M7_World_Release(camera->world);
+    camera->world = NULL;
+
+    if (camera->rowTable.rows)
+    {
+        free(camera->rowTable.rows);
+        camera->rowTable.rows = NULL;
+    }
+
+    glDeleteBuffers(1, &camera->spriteBatch.vbo);
+    glDeleteBuffers(1, &camera->uniforms.ubo);
+    glDeleteVertexArrays(1, &camera->spriteBatch.vao);
+
+#ifdef M7_STATS
+    glDeleteQueries(6, &camera->stats.queries[0][0]);
+    memset(camera->stats.queries, 0, sizeof(camera->stats.queries));
+#endif
+
+    if (camera->spriteBatch.instances)
+    {
+        free(camera->spriteBatch.instances);
+        camera->spriteBatch.instances = NULL;
+    }
+
+    camera->spriteBatch.vao = camera->spriteBatch.vbo = 0;
+    camera->uniforms.ubo = 0;
+    camera->spriteBatch.capacity = 0;
+
+    camera->target.id = camera->target.texture.id = 0;
+    camera->rowTable.texture.id = 0;
+}
+
+/**
+ * Update the camera for rendering a single plane.
+ *
+ * @param camera The camera to update.
+ * @param texture The texture of the plane.
+ * @param position The position of the plane.
+ * @param scale The scale of the plane.
+ * @param wrap The wrap mode for the plane.
+ * @param backgroundColor The background color.
+ */
+void M7_Camera_Update(M7_Camera* camera, Texture2D texture, Vector2 position, Vector2 scale, int wrap, Color backgroundColor)
+{
+    M7_Camera_Begin(camera, backgroundColor);
+        M7_Camera_DrawPlane(camera, texture, position, (Vector2) {
+                (texture.width * scale.x) * 0.5f,
+                (texture.height * scale.y) * 0.5f
+            }, scale, wrap);
+    M7_Camera_End(camera);
+}
+
+/**
+ * Begin rendering with the Mode 7 camera.
+ *
+ * @param camera The camera to begin rendering with.
+ * @param backgroundColor The background color.
+ */
+void M7_Camera_Begin(M7_Camera* camera, Color backgroundColor)
+{
+    M7_STATS_BEGIN_FRAME(camera);
+
+    // The frame time is smoothed, and the scale lowered faster than it is raised,
+    // so that the fill cost, which follows its square, does not oscillate
+
+    if (camera->frameBudget > 0)
+    {
+        const float frameTime = GetFrameTime();
+
+        camera->frameTime = (camera->frameTime > 0) ? camera->frameTime * 0.9f + frameTime * 0.1f : frameTime;
+
+        if (camera->frameTime > camera->frameBudget)
+        {
+            M7_Camera_ApplyResolutionScale(camera, fmaxf(camera->resolutionScale * 0.97f, camera->minResolutionScale));
+        }
+        else if (camera->frameTime < camera->frameBudget * 0.85f)
+        {
+            M7_Camera_ApplyResolutionScale(camera, fminf(camera->resolutionScale * 1.01f, 1.0f));
+        }
+    }
+
+    // The scanlines are only applied through the row table
+
+    const int useRowTable = ((camera->state & M7_STATE_ROW_TABLE) || camera->rowTable.scanlines) ? 1 : 0;
+
+    if (useRowTable && camera->rowTable.dirty)
+    {
+        M7_Camera_UpdateRowTable(camera);
+    }
+
+    if (camera->uniforms.data.useRowTable != useRowTable)
+    {
+        camera->uniforms.data.useRowTable = useRowTable;
+        camera->uniforms.dirty = true;
+    }
+
+    if (camera->software.enabled)
+    {
+        M7_Software_Clear(camera, backgroundColor);
+        return;
+    }
+
+    BeginTextureMode(camera->target);
+    ClearBackground(backgroundColor);
+
+    // With a resolution scale, the view is rendered in the bottom left corner of the target with the
+    // same projection, so all the coordinates stay those of the full size target (see M7_Camera_Render())
+
+    if (camera->resolutionScale < 1.0f)
+    {
+        int width, height;
+        M7_Camera_GetViewport(camera, &width, &height);
+
+        rlDrawRenderBatchActive();
+        rlViewport(0, 0, width, height);
+    }
+
+    M7_STATS_TIMESTAMP(camera, 0);
+}
+
+/**
+ * End rendering with the Mode 7 camera.
+ *
+ * @param camera The camera to end rendering with.
+ */
+void M7_Camera_End(M7_Camera* camera)
+{
+    M7_ZBuffer* buffer = &camera->world->buffer;
+    M7_ZBuffer_View* view = camera->view;
+
+    // The order of the elements can only change if at least one has been projected again or removed
+    // Only the visible elements, placed first, are sorted and drawn
+    // In depth buffer mode only the translucent elements, placed first, need to be sorted
+
+    M7_STATS_TIME(updateStart);
+
+    const uint32_t updated = M7_ZBuffer_Update(camera);
+    M7_STATS_COUNT(camera, updatedElements, updated);
+
+    bool changed = (updated > 0) || view->orderDirty;
+
+    if (changed)
+    {
+        M7_ZBuffer_Cull(buffer, view);
+        view->orderDirty = false;
+
+        const uint32_t batchCount = (view->visibleCount + M7_JOB_BATCH_SIZE - 1) / M7_JOB_BATCH_SIZE;
+        M7_Camera_ParallelFor(camera, M7_ZBuffer_UpdateKeysJob, view, batchCount);
+    }
+
+    M7_STATS_ADD(camera, M7_STAGE_UPDATE, updateStart);
+    M7_STATS_TIME(sortStart);
+
+    uint32_t sortCount = view->visibleCount;
+
+    // The software backend composites the elements in order, so they are all sorted
+
+    if ((camera->state & M7_STATE_DEPTH_BUFFER) && !camera->software.enabled)
+    {
+        changed |= M7_ZBuffer_Partition(buffer, view);
+        sortCount = view->translucentCount;
+    }
+
+    if (changed || sortCount != view->sortedCount)
+    {
+        M7_ZBuffer_Sort(view, sortCount);
+        view->sortedCount = sortCount;
+
+        // Only the draw list is reordered by the sort and the partition
+
+        for (uint32_t i = 0; i < view->visibleCount; i++)
+        {
+            view->orderOf[view->order[i].index] = i;
+        }
+    }
+    else
+    {
+        view->lastSort = M7_SORT_NONE;
+    }
+
+    M7_STATS_ADD(camera, M7_STAGE_SORT, sortStart);
+    M7_STATS_TIME(drawStart);
+
+    // The cells of the picking are binned again from the new draw list when needed
+
+    camera->pick.valid = false;
+
+    if (camera->software.enabled)
+    {
+        M7_Software_DrawElements(camera);
+
+        M7_STATS_ADD(camera, M7_STAGE_DRAW, drawStart);
+        M7_STATS_END_FRAME(camera);
+        return;
+    }
+
+    M7_STATS_TIMESTAMP(camera, 1);
+
+    M7_ZBuffer_Draw(camera);
+
+    EndTextureMode();
+
+    M7_STATS_TIMESTAMP(camera, 2);
+    M7_STATS_ADD(camera, M7_STAGE_DRAW, drawStart);
+    M7_STATS_END_FRAME(camera);
+}
+
+/**
+ * Draw a plane using the Mode 7 camera.
+ *
+ * TODO: Add parameter 'Rectangle source'
+ *       and make the shader compatible 
+ *       with this new feature.
+ *
+ * @param camera The camera to use for drawing.
+ * @param texture The texture of the plane.
+ * @param position The position of the plane.
+ * @param origin The origin of the plane.
+ * @param scale The scale of the plane.
+ * @param wrap The wrap mode for the plane.
+ */
+void M7_Camera_DrawPlane(M7_Camera* camera, Texture2D texture, Vector2 position, Vector2 origin, Vector2 scale, int wrap)
+{
+    if (camera->software.enabled) return;
+
+    M7_STATS_TIME(statsStart);
+
+    const float mapSize[2] = {
+        texture.width * scale.x,
+        texture.height * scale.y
+    };
+
+    const float camPos[2] = {
+        camera->position.x + position.x + origin.x,
+        camera->position.y + position.y + origin.y
+    };
+
+    // The plane covers the world area [-(position + origin), -(position + origin) + mapSize],
+    // only the part of the screen where this area is projected needs to be shaded
+
+    Rectangle bounds = { 0, 0, (float)camera->target.texture.width, (float)camera->target.texture.height };
+
+    if (!wrap && !camera->rowTable.scanlines && !M7_Camera_GetPlaneBounds(camera, (Rectangle) {
+            -(position.x + origin.x), -(position.y + origin.y),
+            mapSize[0], mapSize[1]
+        }, &bounds))
+    {
+        return;
+    }
+
+    if (!M7_Camera_ClipFarRows(camera, &bounds)) return;
+
+    const float maxLod = fmaxf(fminf(camera->maxLod, (float)(texture.mipmaps - 1)), 0.0f);
+
+    M7_Camera_UseUniforms(camera);
+
+    M7_Uniform_Set(camera->programs->planeProgram.shader, &camera->programs->planeProgram.mapSize, mapSize);
+    M7_Uniform_Set(camera->programs->planeProgram.shader, &camera->programs->planeProgram.camPos, camPos);
+    M7_Uniform_Set(camera->programs->planeProgram.shader, &camera->programs->planeProgram.wrap, &wrap);
+    M7_Uniform_Set(camera->programs->planeProgram.shader, &camera->programs->planeProgram.maxLod, &maxLod);
+
+    BeginShaderMode(camera->programs->planeProgram.shader);
+        SetShaderValueTexture(camera->programs->planeProgram.shader, camera->programs->planeProgram.locMapTex, texture);
+        SetShaderValueTexture(camera->programs->planeProgram.shader, camera->programs->planeProgram.locRowTable, camera->rowTable.texture);
+        M7_Camera_DrawPlaneQuad(camera, bounds);
+    EndShaderMode();
+
+    M7_STATS_COUNT(camera, planePasses, 1);
+    M7_STATS_COUNT(camera, drawCalls, 1);
+    M7_STATS_ADD(camera, M7_STAGE_PLANES, statsStart);
+}
+
+/**
+ * Draw a tilemap using the Mode 7 camera.
+ * All the tiles are resolved by the tilemap shader in a single pass.
+ *
+ * @param camera The camera to use for drawing.
+ * @param tilemap The tilemap to draw (its indices are uploaded here if they have changed).
+ * @param position The position of the tilemap.
+ * @param origin The origin of the tilemap.
+ * @param scale The scale of the tilemap.
+ * @param wrap The wrap mode for the tilemap.
+ */
+void M7_Camera_DrawTilemap(M7_Camera* camera, M7_Tilemap* tilemap, Vector2 position, Vector2 origin, Vector2 scale, int wrap)
+{
+    if (camera->software.enabled) return;
+
+    M7_STATS_TIME(statsStart);
+
+    if (tilemap->dirty)
+    {
+        UpdateTexture(tilemap->indices, tilemap->tiles);
+        tilemap->dirty = false;
+    }
+
+    const float atlasSize[2] = {
+        (float)tilemap->atlas.width,
+        (float)tilemap->atlas.height
+    };
+
+    const float tileSize[2] = {
+        (float)tilemap->tileWidth,
+        (float)tilemap->tileHeight
+    };
+
+    const int gridSize[2] = {
+        tilemap->width,
+        tilemap->height
+    };
+
+    const float mapSize[2] = {
+        tilemap->width * tilemap->tileWidth * scale.x,
+        tilemap->height * tilemap->tileHeight * scale.y
+    };
+
+    const float camPos[2] = {
+        camera->position.x + position.x + origin.x,
+        camera->position.y + position.y + origin.y
+    };
+
+    Rectangle bounds = { 0, 0, (float)camera->target.texture.width, (float)camera->target.texture.height };
+
+    if (!wrap && !camera->rowTable.scanlines && !M7_Camera_GetPlaneBounds(camera, (Rectangle) {
+            -(position.x + origin.x), -(position.y + origin.y),
+            mapSize[0], mapSize[1]
+        }, &bounds))
+    {
+        return;
+    }
+
+    if (!M7_Camera_ClipFarRows(camera, &bounds)) return;
+
+    const float maxLod = fmaxf(fminf(camera->maxLod, (float)(tilemap->atlas.mipmaps - 1)), 0.0f);
+
+    M7_Camera_UseUniforms(camera);
+
+    M7_Uniform_Set(camera->programs->tilemapProgram.shader, &camera->programs->tilemapProgram.atlasSize, atlasSize);
+    M7_Uniform_Set(camera->programs->tilemapProgram.shader, &camera->programs->tilemapProgram.tileSize, tileSize);
+    M7_Uniform_Set(camera->programs->tilemapProgram.shader, &camera->programs->tilemapProgram.gridSize, gridSize);
+    M7_Uniform_Set(camera->programs->tilemapProgram.shader, &camera->programs->tilemapProgram.mapSize, mapSize);
+    M7_Uniform_Set(camera->programs->tilemapProgram.shader, &camera->programs->tilemapProgram.camPos, camPos);
+    M7_Uniform_Set(camera->programs->tilemapProgram.shader, &camera->programs->tilemapProgram.wrap, &wrap);
+    M7_Uniform_Set(camera->programs->tilemapProgram.shader, &camera->programs->tilemapProgram.maxLod, &maxLod);
+
+    BeginShaderMode(camera->programs->tilemapProgram.shader);
+        SetShaderValueTexture(camera->programs->tilemapProgram.shader, camera->programs->tilemapProgram.locAtlasTex, tilemap->atlas);
+        SetShaderValueTexture(camera->programs->tilemapProgram.shader, camera->programs->tilemapProgram.locTilesTex, tilemap->indices);
+        SetShaderValueTexture(camera->programs->tilemapProgram.shader, camera->programs->tilemapProgram.locRowTable, camera->rowTable.texture);
+        M7_Camera_DrawPlaneQuad(camera, bounds);
+    EndShaderMode();
+
+    M7_STATS_COUNT(camera, planePasses, 1);
+    M7_STATS_COUNT(camera, drawCalls, 1);
+    M7_STATS_ADD(camera, M7_STAGE_PLANES, statsStart);
+}
+
+/**
+ * Draw a virtual texture using the Mode 7 camera.
+ * The pages of the map under the view of the camera are kept in its cache, the missing ones
+ * are requested through its callback, the nearest ones first, and drawn with its fallback color
+ * until they are submitted. The view is limited by the far distance of the camera, without it
+ * the pages of the whole map are requested.
+ *
+ * @param camera The camera to use for drawing.
+ * @param texture The virtual texture to draw (its page table is uploaded here if it has changed).
+ * @param position The position of the map.
+ * @param origin The origin of the map.
+ * @param scale The scale of the map.
+ * @param wrap The wrap mode for the map.
+ */
+void M7_Camera_DrawVirtualTexture(M7_Camera* camera, M7_VirtualTexture* texture, Vector2 position, Vector2 origin, Vector2 scale, int wrap)
+{
+    if (camera->software.enabled) return;
+
+    M7_STATS_TIME(statsStart);
+
+    if (!texture->table) return;
+
+    const float mapTexels[2] = {
+        (float)texture->width,
+        (float)texture->height
+    };
+
+    const float mapSize[2] = {
+        texture->width * scale.x,
+        texture->height * scale.y
+    };
+
+    const float camPos[2] = {
+        camera->position.x + position.x + origin.x,
+        camera->position.y + position.y + origin.y
+    };
+
+    Rectangle bounds = { 0, 0, (float)camera->target.texture.width, (float)camera->target.texture.height };
+
+    if (!wrap && !camera->rowTable.scanlines && !M7_Camera_GetPlaneBounds(camera, (Rectangle) {
+            -(position.x + origin.x), -(position.y + origin.y),
+            mapSize[0], mapSize[1]
+        }, &bounds))
+    {
+        return;
+    }
+
+    if (!M7_Camera_ClipFarRows(camera, &bounds)) return;
+
+    M7_VirtualTexture_Feedback(texture, camera, (Vector2) { -(position.x + origin.x), -(position.y + origin.y) }, scale, wrap);
+
+    if (texture->dirty)
+    {
+        UpdateTexture(texture->pageTable, texture->table);
+        texture->dirty = false;
+    }
+
+    const float pageSize = (float)texture->pageSize;
+    const Vector4 fallback = ColorNormalize(texture->fallback);
+
+    M7_Camera_UseUniforms(camera);
+
+    M7_Uniform_Set(camera->programs->virtualProgram.shader, &camera->programs->virtualProgram.mapTexels, mapTexels);
+    M7_Uniform_Set(camera->programs->virtualProgram.shader, &camera->programs->virtualProgram.pageSize, &pageSize);
+    M7_Uniform_Set(camera->programs->virtualProgram.shader, &camera->programs->virtualProgram.fallback, &fallback);
+    M7_Uniform_Set(camera->programs->virtualProgram.shader, &camera->programs->virtualProgram.mapSize, mapSize);
+    M7_Uniform_Set(camera->programs->virtualProgram.shader, &camera->programs->virtualProgram.camPos, camPos);
+    M7_Uniform_Set(camera->programs->virtualProgram.shader, &camera->programs->virtualProgram.wrap, &wrap);
+
+    BeginShaderMode(camera->programs->virtualProgram.shader);
+        SetShaderValueTexture(camera->programs->virtualProgram.shader, camera->programs->virtualProgram.locCacheTex, texture->cache);
+        SetShaderValueTexture(camera->programs->virtualProgram.shader, camera->programs->virtualProgram.locPageTable, texture->pageTable);
+        SetShaderValueTexture(camera->programs->virtualProgram.shader, camera->programs->virtualProgram.locRowTable, camera->rowTable.texture);
+        M7_Camera_DrawPlaneQuad(camera, bounds);
+    EndShaderMode();
+
+    M7_STATS_COUNT(camera, planePasses, 1);
+    M7_STATS_COUNT(camera, drawCalls, 1);
+    M7_STATS_ADD(camera, M7_STAGE_PLANES, statsStart);
+}
+
+/**
+ * Render the final view of the camera to the screen.
+ * The view is upscaled to the size of the target when it is rendered with a resolution scale.
+ * Nothing is drawn for a camera of the software backend, whose view is read from 'camera.software.image'.
+ *
+ * @param camera The camera to render.
+ */
+void M7_Camera_Render(M7_Camera* camera)
+{
+    if (camera->software.enabled) return;
+
+    int width, height;
+    M7_Camera_GetViewport(camera, &width, &height);
+
+    DrawTexturePro(camera->target.texture,
+        (Rectangle){ 0, 0, width, -height },
+        (Rectangle){ 0, 0, camera->target.texture.width, camera->target.texture.height },
+        (Vector2){0}, 0, WHITE);
+}
+
+/**
+ * Set the position of the Mode 7 camera.
+ *
+ * @param camera The camera to set the position for.
+ * @param position The new position.
+ */
+void M7_Camera_SetPosition(M7_Camera* camera, Vector2 position)
+{
+    if (camera->position.x != position.x || camera->position.y != position.y) camera->version++;
+    camera->position = position; // Position sent in addition to the origin of the plane in DrawPlane()
+}
+
+/**
+ * Set the rotation of the Mode 7 camera.
+ *
+ * @param camera The camera to set the rotation for.
+ * @param rotation The new rotation.
+ */
+void M7_Camera_SetRotation(M7_Camera* camera, float rotation)
+{
+    if (camera->rotation != rotation)
+    {
+        camera->rowTable.dirty = true;
+        camera->uniforms.dirty = true;
+        camera->version++;
+    }
+    camera->rotation = rotation;
+
+    float cosR = cosf(rotation);
+    float sinR = sinf(rotation);
+
+    camera->rotMat.m0 = cosR;
+    camera->rotMat.m1 = -sinR;
+    camera->rotMat.m2 = sinR;
+    camera->rotMat.m3 = cosR;
+
+    // The columns of a std140 mat2 are aligned on a vec4, the matrix is read in column-major order
+
+    float *camRot = camera->uniforms.data.camRot;
+
+    camRot[0] = camera->rotMat.m0, camRot[1] = camera->rotMat.m1;
+    camRot[4] = camera->rotMat.m2, camRot[5] = camera->rotMat.m3;
+}
+
+/**
+ * Set the zoom of the Mode 7 camera.
+ *
+ * @param camera The camera to set the zoom for.
+ * @param zoom The new zoom value.
+ */
+void M7_Camera_SetZoom(M7_Camera* camera, float zoom)
+{
+    if (camera->zoom != zoom)
+    {
+        camera->rowTable.dirty = true;
+        camera->uniforms.dirty = true;
+        camera->version++;
+    }
+    camera->zoom = zoom;
+    camera->uniforms.data.zoom = zoom;
+}
+
+/**
+ * Set the field of view (FOV) of the Mode 7 camera.
+ *
+ * @param camera The camera to set the FOV for.
+ * @param fov The new FOV value.
+ */
+void M7_Camera_SetFOV(M7_Camera* camera, float fov)
+{
+    if (camera->fov != fov)
+    {
+        camera->rowTable.dirty = true;
+        camera->uniforms.dirty = true;
+        camera->version++;
+    }
+    camera->fov = fov;
+    camera->uniforms.data.fov = fov;
+}
+
+/**
+ * Set the offset of the Mode 7 camera.
+ *
+ * @param camera The camera to set the offset for.
+ * @param offset The new offset value.
+ */
+void M7_Camera_SetOffset(M7_Camera* camera, float offset)
+{
+    if (camera->offset != offset)
+    {
+        camera->rowTable.dirty = true;
+        camera->uniforms.dirty = true;
+        camera->version++;
+    }
+    camera->offset = offset;
+    camera->uniforms.data.offset = offset;
+}
+
+/**
+ * Set the resolution scale of the Mode 7 camera.
+ * The view is rendered in a part of the target of this fraction of its size, then upscaled by
+ * M7_Camera_Render(). The coordinates of the elements and of the conversions are not affected.
+ *
+ * @param camera The camera to modify.
+ * @param scale The fraction of the size of the target (clamped between 1/16 and 1).
+ */
+void M7_Camera_SetResolutionScale(M7_Camera* camera, float scale)
+{
+    M7_Camera_ApplyResolutionScale(camera, scale);
+}
+
+/**
+ * Set the frame time budget of the Mode 7 camera.
+ * On each call to M7_Camera_Begin(), the resolution scale is lowered while the smoothed frame time
+ * given by GetFrameTime() exceeds the budget, and raised back toward 1 when there is enough margin.
+ * With VSync the frame time never goes below the refresh period, so the budget must be above it.
+ *
+ * @param camera The camera to modify.
+ * @param budget The frame time to hold in seconds (0 to keep the current scale).
+ * @param minScale The lowest resolution scale that can be reached.
+ */
+void M7_Camera_SetFrameBudget(M7_Camera* camera, float budget, float minScale)
+{
+    camera->frameBudget = fmaxf(budget, 0.0f);
+    camera->minResolutionScale = fminf(fmaxf(minScale, 1.0f / 16), 1.0f);
+    camera->frameTime = 0;
+}
+
+/**
+ * Set state flags of the Mode 7 camera.
+ *
+ * @param camera The camera to modify.
+ * @param flags The M7_Camera_State flags to set.
+ */
+void M7_Camera_SetState(M7_Camera* camera, unsigned int flags)
+{
+    camera->state |= flags;
+}
+
+/**
+ * Clear state flags of the Mode 7 camera.
+ *
+ * @param camera The camera to modify.
+ * @param flags The M7_Camera_State flags to clear.
+ */
+void M7_Camera_ClearState(M7_Camera* camera, unsigned int flags)
+{
+    camera->state &= ~flags;
+}
+
+/**
+ * Check if a state flag of the Mode 7 camera is set.
+ *
+ * @param camera The camera to check.
+ * @param flag The M7_Camera_State flag to check.
+ *
+ * @return True if the flag is set, false otherwise.
+ */
+bool M7_Camera_IsState(const M7_Camera* camera, unsigned int flag)
+{
+    return (camera->state & flag) == flag;
+}
+
+/**
+ * Set the sort strategy used to order the elements of the Mode 7 camera by depth.
+ *
+ * @param camera The camera to modify.
+ * @param mode The sort strategy to use (M7_SORT_NONE is not a valid strategy and is ignored).
+ */
+void M7_Camera_SetSortMode(M7_Camera* camera, M7_SortMode mode)
+{
+    if (mode != M7_SORT_NONE) camera->view->sortMode = mode;
+}
+
+/**
+ * Get the sort path that ran on the last frame rendered by the Mode 7 camera.
+ *
+ * @param camera The camera to check.
+ *
+ * @return The sort path that ran, or M7_SORT_NONE if the sort was skipped.
+ */
+M7_SortMode M7_Camera_GetSortPath(const M7_Camera* camera)
+{
+    return camera->view->lastSort;
+}
+
+/**
+ * Set the callback used to spread the update and the visibility test of the elements over worker threads.
+ * The callback receives a number of batches of M7_JOB_BATCH_SIZE elements, it can run the job on any
+ * sub-ranges from any threads but must only return once they are all done. The job never calls raylib
+ * or OpenGL, the sort and the draw calls are always done afterwards on the calling thread.
+ *
+ * @param camera The camera to modify.
+ * @param parallelFor The callback, or NULL to update the elements on the calling thread.
+ * @param userData The user data given to the callback.
+ */
+void M7_Camera_SetParallelFor(M7_Camera* camera, M7_ParallelFor parallelFor, void* userData)
+{
+    camera->parallelFor = parallelFor;
+    camera->parallelData = userData;
+}
+
+/**
+ * Set the distance in front of the camera beyond which the elements are not drawn.
+ * The distance also bounds the view area used to query the spatial index.
+ *
+ * @param camera The camera to modify.
+ * @param distance The distance in world units (0 for no limit).
+ */
+void M7_Camera_SetFarDistance(M7_Camera* camera, float distance)
+{
+    distance = fmaxf(distance, 0.0f);
+    if (camera->farDistance != distance) camera->version++;
+    camera->farDistance = distance;
+
+    M7_Camera_SetFog(camera, camera->fogColor, camera->fogStart);
+}
+
+/**
+ * Set the fog of the planes of the Mode 7 camera.
+ * The rows of the planes beyond the far distance are filled with the fog color without sampling their texture,
+ * and the planes are blended toward the fog color from the start distance up to the far distance.
+ * The fog has no effect without a far distance (see M7_Camera_SetFarDistance()).
+ *
+ * @param camera The camera to modify.
+ * @param color The fog color (BLANK to show the background beyond the far distance).
+ * @param start The distance in world units from which the fog starts (INFINITY for a cutoff at the far distance only).
+ */
+void M7_Camera_SetFog(M7_Camera* camera, Color color, float start)
+{
+    camera->fogColor = color;
+    camera->fogStart = start;
+
+    const Vector4 fogColor = ColorNormalize(color);
+    const float fogRange[2] = { fminf(fmaxf(start, 0.0f), camera->farDistance), camera->farDistance };
+
+    memcpy(camera->uniforms.data.fogColor, &fogColor, sizeof(fogColor));
+    memcpy(camera->uniforms.data.fogRange, fogRange, sizeof(fogRange));
+
+    camera->uniforms.dirty = true;
+}
+
+/**
+ * Set the highest mipmap level sampled on the planes of the Mode 7 camera.
+ * The level of each pixel is derived from its distance, lowering the limit trades
+ * sharpness toward the horizon for fewer texture cache misses on large maps.
+ * The maps must have mipmaps (see GenTextureMipmaps()) and a mipmap filter for the levels to be used.
+ *
+ * @param camera The camera to modify.
+ * @param lod The highest mipmap level (0 to always sample the full resolution level).
+ */
+void M7_Camera_SetMaxLOD(M7_Camera* camera, float lod)
+{
+    camera->maxLod = fmaxf(lod, 0.0f);
+}
+
+/**
+ * Set the modulation of the plane projection on each row of the view (HDMA-style effects).
+ * The scanlines are spread over the rows of the viewport from the top, and baked into the row table,
+ * which is used by the planes as long as scanlines are set, even without M7_STATE_ROW_TABLE.
+ * The table is only rebuilt when the scanlines differ from the previous ones, so they can be set on each frame.
+ *
+ * Only the planes are modulated: the elements, the coordinate conversions and the fog keep the parameters
+ * of the camera, and the planes are shaded over the whole view instead of their projected bounds.
+ *
+ * @param camera The camera to modify.
+ * @param scanlines The modulation of each scanline (copied, NULL to remove the scanlines).
+ * @param count The number of scanlines (usually the height of the view).
+ *
+ * @return False if the scanlines could not be allocated, true otherwise.
+ */
+bool M7_Camera_SetScanlines(M7_Camera* camera, const M7_Scanline* scanlines, int count)
+{
+    if (!scanlines || count <= 0)
+    {
+        if (camera->rowTable.scanlines)
+        {
+            free(camera->rowTable.scanlines);
+            camera->rowTable.scanlines = NULL;
+            camera->rowTable.scanlineCount = 0;
+            camera->rowTable.dirty = true;
+        }
+
+        return true;
+    }
+
+    if (count != camera->rowTable.scanlineCount)
+    {
+        M7_Scanline *copy = (M7_Scanline*)realloc(camera->rowTable.scanlines, count * sizeof(M7_Scanline));
+        if (!copy) return false;
+
+        camera->rowTable.scanlines = copy;
+        camera->rowTable.scanlineCount = count;
+    }
+    else if (memcmp(camera->rowTable.scanlines, scanlines, count * sizeof(M7_Scanline)) == 0)
+    {
+        return true;
+    }
+
+    memcpy(camera->rowTable.scanlines, scanlines, count * sizeof(M7_Scanline));
+    camera->rowTable.dirty = true;
+
+    return true;
+}
+
+/**
+ * Get the measures of the last completed frame of the Mode 7 camera.
+ * The measures are only taken when the module is compiled with M7_STATS, they stay at zero otherwise.
+ *
+ * @param camera The camera to check.
+ *
+ * @return The measures of the last frame rendered between M7_Camera_Begin() and M7_Camera_End().
+ */
+const M7_Stats* M7_Camera_GetStats(const M7_Camera* camera)
+{
+#ifdef M7_STATS
+    return &camera->stats.last;
+#else
+    static const M7_Stats empty = {0};
+    (void)camera;
+    return &empty;
+#endif
+}
+
+/**
+ * Draw the measures of the last completed frame of the Mode 7 camera as text lines.
+ *
+ * @param camera The camera whose measures are drawn.
+ * @param x The X position of the text.
+ * @param y The Y position of the first line.
+ * @param fontSize The font size, which is also the height of a line.
+ * @param color The color of the text.
+ */
+void M7_Camera_DrawStats(const M7_Camera* camera, int x, int y, int fontSize, Color color)
+{
+#ifdef M7_STATS
+    const M7_Stats *stats = M7_Camera_GetStats(camera);
+
+    DrawText(TextFormat("CPU: %.2f planes, %.2f update, %.2f sort, %.2f draw (ms)",
+        1e3 * stats->cpuTime[M7_STAGE_PLANES], 1e3 * stats->cpuTime[M7_STAGE_UPDATE],
+        1e3 * stats->cpuTime[M7_STAGE_SORT], 1e3 * stats->cpuTime[M7_STAGE_DRAW]), x, y, fontSize, color);
+
+    DrawText(TextFormat("GPU: %.2f planes, %.2f draw (ms)",
+        1e3 * stats->gpuTime[M7_STAGE_PLANES], 1e3 * stats->gpuTime[M7_STAGE_DRAW]), x, y + fontSize, fontSize, color);
+
+    DrawText(TextFormat("Draw calls: %u (%u plane passes, %u batched elements)",
+        stats->drawCalls, stats->planePasses, stats->batchedElements), x, y + 2 * fontSize, fontSize, color);
+
+    DrawText(TextFormat("Elements: %u updated, %u drawn",
+        stats->updatedElements, stats->drawnElements), x, y + 3 * fontSize, fontSize, color);
+#else
+    (void)camera;
+    DrawText("Stats disabled (define M7_STATS)", x, y, fontSize, color);
+#endif
+}
+
+/**
+ * Enable the spatial index of the elements of the camera, replacing the previous one if any.
+ * The elements are stored in a hash grid of the given cell size and, on each frame, only the elements of the
+ * cells covered by the view of the camera, limited by its far distance, are updated, sorted and drawn.
+ * Without a far distance, or if the view covers more cells than there are elements, all the elements are updated.
+ * The elements must be moved with M7_Element_SetPosition(), or marked with M7_Element_MarkDirty() after
+ * modifying their fields, for the index to follow them.
+ *
+ * @param camera The camera to modify.
+ * @param cellSize The size of the cells of the grid in world units (around the size of the view at mid distance is a good start).
+ *
+ * @return True if the index has been enabled, false if the cell size is invalid or an allocation failed.
+ */
+bool M7_Camera_EnableSpatialIndex(M7_Camera* camera, float cellSize)
+{
+    M7_ZBuffer *buffer = &camera->world->buffer;
+
+    if (!(cellSize > 0)) return false;
+
+    M7_Camera_DisableSpatialIndex(camera);
+
+    M7_SpatialIndex *grid = M7_SpatialIndex_Load(cellSize, buffer->capacity);
+    if (!grid) return false;
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        buffer->elems[i]->grid = grid;
+        M7_SpatialIndex_Insert(grid, buffer->elems[i]);
+    }
+
+    buffer->grid = grid;
+
+    // Forces the update of all the elements with the index on the next frame
+
+    camera->version++;
+
+    return true;
+}
+
+/**
+ * Disable the spatial index of the elements of the camera.
+ *
+ * @param camera The camera to modify.
+ */
+void M7_Camera_DisableSpatialIndex(M7_Camera* camera)
+{
+    M7_ZBuffer *buffer = &camera->world->buffer;
+
+    if (!buffer->grid) return;
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        buffer->elems[i]->grid = NULL;
+    }
+
+    M7_SpatialIndex_Unload(buffer->grid);
+    buffer->grid = NULL;
+
+    // Forces the update of all the elements without the index on the next frame
+
+    camera->version++;
+}
+
+/**
+ * Make a camera render the elements of another camera, for example for the views of a split-screen.
+ * The elements are stored once and keep their handles, whichever camera is used to add or modify them.
+ * The elements previously rendered by the camera are released with its world if it was not shared.
+ *
+ * Each camera keeps its own projection of the elements, draw list and sort state, so the retained mode
+ * and the sort coherence hold for each view, but the cameras must not end their frames concurrently.
+ * The spatial index, if any, is shared too and limits the projection to the cells under each view.
+ *
+ * @param camera The camera to modify.
+ * @param source The camera whose elements are rendered.
+ *
+ * @return False if the source has no world or the view of its elements could not be allocated, true otherwise.
+ */
+bool M7_Camera_ShareWorld(M7_Camera* camera, const M7_Camera* source)
+{
+    if (!source->world) return false;
+    if (camera->world == source->world) return true;
+
+    // All the elements of the new world are projected by the first frame of the new view
+
+    M7_ZBuffer_View *view = M7_ZBuffer_View_Load(&source->world->buffer);
+    if (!view) return false;
+
+    if (camera->view)
+    {
+        view->sortMode = camera->view->sortMode;
+        M7_ZBuffer_View_Unload(&camera->world->buffer, camera->view);
+    }
+
+    M7_World_Release(camera->world);
+
+    camera->world = source->world;
+    camera->world->refCount++;
+    camera->view = view;
+    camera->pick.valid = false;
+
+    return true;
+}
+
+/**
+ * Get the screen display coordinates with which an element was last projected by a camera.
+ * They are those of the last frame that projected the element, so they are not updated
+ * by the modifications of the element until the next M7_Camera_End().
+ *
+ * @param camera The Mode 7 camera.
+ * @param elem The element, which must be in the world of the camera.
+ * @param rect Receives the screen rectangle of the element (can be NULL).
+ * @param position Receives the screen position of the element (can be NULL).
+ * @param distance Receives the distance of the element with the camera, negative behind it (can be NULL).
+ *
+ * @return False if the element is not in the world of the camera or has not been projected by it yet, true otherwise.
+ */
+bool M7_Camera_GetElementScreen(const M7_Camera* camera, const M7_Element* elem, Rectangle* rect, Vector2* position, float* distance)
+{
+    if (!camera->view || !elem || !elem->alive) return false;
+
+    const M7_ZBuffer *buffer = &camera->world->buffer;
+    const M7_ZBuffer_View *view = camera->view;
+
+    if (elem->index >= buffer->count || buffer->elems[elem->index] != elem) return false;
+    if (view->revisions[elem->index] == 0) return false;
+
+    if (rect) *rect = view->onScreen[elem->index].rectangle;
+    if (position) *position = view->onScreen[elem->index].position;
+    if (distance) *distance = view->distance[elem->index];
+
+    return true;
+}
+
+/**
+ * Translate the Mode 7 camera by a given amount.
+ *
+ * @param camera The camera to translate.
+ * @param dx The change in X position.
+ * @param dy The change in Y position.
+ */
+void M7_Camera_Translate(M7_Camera* camera, float dx, float dy)
+{
+    M7_Camera_SetPosition(camera, (Vector2) {
+        camera->position.x + (dx * camera->rotMat.m0 + dy * camera->rotMat.m1),
+        camera->position.y + (dx * camera->rotMat.m2 + dy * camera->rotMat.m3)
+    });
+}
+
+/**
+ * Rotate the Mode 7 camera by a specified delta angle.
+ *
+ * @param camera The camera to rotate.
+ * @param delta The rotation angle change.
+ */
+void M7_Camera_Rotate(M7_Camera* camera, float delta)
+{
+    M7_Camera_SetRotation(camera, camera->rotation + delta);
+}
+
+/**
+ * Move the Mode 7 camera based on user input and speed.
+ *
+ * @param camera The camera to move.
+ * @param speed The movement speed.
+ */
+void M7_Camera_Move(M7_Camera* camera, float speed)
+{
+    float dt = GetFrameTime(); speed *= dt;
+
+    float dx = (IsKeyDown(KEY_A) - IsKeyDown(KEY_D));
+    float dy = (IsKeyDown(KEY_W) - IsKeyDown(KEY_S));
+
+    if (dx || dy)
+    {
+        float mag = sqrtf(dx*dx + dy*dy);
+        dx /= mag, dy /= mag;
+    }
+
+    M7_Camera_Translate(camera, dx*speed, dy*speed);
+    M7_Camera_Rotate(camera, (IsKeyDown(KEY_RIGHT) - IsKeyDown(KEY_LEFT)) * dt);
+
+    M7_Camera_SetFOV(camera, camera->fov + -GetMouseWheelMove() * 0.1f);
+    M7_Camera_SetZoom(camera, camera->zoom + (IsKeyDown(KEY_DOWN) - IsKeyDown(KEY_UP)) * speed);
+    M7_Camera_SetOffset(camera, camera->offset + (IsKeyDown(KEY_PAGE_DOWN) - IsKeyDown(KEY_PAGE_UP)) * dt);
+}
+
+/**
+ * Convert world coordinates to screen coordinates using the Mode 7 camera.
+ *
+ * @param camera The Mode 7 camera.
+ * @param point The world coordinates to convert.
+ *
+ * @return The screen coordinates in Vector3 format with (x, y) and distance (z).
+ */
+Vector3 M7_ToScreen(M7_Camera* camera, Vector2 point)
+{
+    // Determine the coordinates in camera space
+    float objX = -(camera->position.x - point.x) / camera->zoom;
+    float objY = (camera->position.y - point.y) / camera->zoom;
+
+    // Apply the camera rotation
+    float spaceX = -objX * camera->rotMat.m0 - objY * camera->rotMat.m1;
+    float spaceY = (objX * camera->rotMat.m2 + objY * camera->rotMat.m3) * camera->fov;
+
+    // Calculate the distance relative to the camera
+    float distance = 1 - spaceY;
+
+    // Calculate the coordinates on the screen
+    float screenPosX = (spaceX / distance) * camera->offset * camera->target.texture.width + camera->target.texture.width / 2;
+    float screenPosY = ((spaceY + camera->offset - 1) / distance) * camera->target.texture.height + camera->target.texture.height;
+
+    // Calculate the approximate size in pixels on the plane
+    float size = (camera->offset * camera->target.texture.width) / (camera->zoom * distance);
+
+    return (Vector3) { screenPosX, screenPosY, size };
+}
+
+/**
+ * Convert screen coordinates to world coordinates using the Mode 7 camera.
+ *
+ * @param camera The Mode 7 camera.
+ * @param point The screen coordinates to convert.
+ *
+ * @return The world coordinates in Vector2 format.
+ */
+Vector2 M7_ToWorld(M7_Camera* camera, Vector2 point)
+{
+    float sx = (camera->target.texture.width / 2 - point.x) * (camera->zoom / camera->aspect);
+    float sy = (camera->offset * camera->target.texture.height - point.y) * (camera->zoom / camera->fov);
+
+    float rotX = sx * camera->rotMat.m0 + sy * camera->rotMat.m1;
+    float rotY = sx * camera->rotMat.m2 + sy * camera->rotMat.m3;
+
+    return (Vector2) {
+        rotX / point.y + camera->position.x,
+        rotY / point.y + camera->position.y
+    };
+}
+
+/**
+ * Convert an array of world coordinates to screen coordinates using the Mode 7 camera.
+ * The camera terms are computed once for the whole array and each point costs a single division.
+ *
+ * @param camera The Mode 7 camera.
+ * @param points The world coordinates to convert.
+ * @param out The screen coordinates in Vector3 format with (x, y) and distance (z), can't overlap with 'points'.
+ * @param count The number of coordinates to convert.
+ */
+void M7_ToScreenN(M7_Camera* camera, const Vector2* points, Vector3* out, size_t count)
+{
+    const M7_Projection proj = M7_Camera_GetProjection(camera);
+
+    for (size_t i = M7_ToScreen_SIMD(&proj, points, out, count); i < count; i++)
+    {
+        const float dx = points[i].x - proj.camX;
+        const float dy = points[i].y - proj.camY;
+
+        const float spaceX = dx * proj.spaceXX + dy * proj.spaceXY;
+        const float spaceY = dx * proj.spaceYX + dy * proj.spaceYY;
+
+        const float invDistance = 1.0f / (1.0f - spaceY);
+
+        out[i] = (Vector3) {
+            spaceX * invDistance * proj.screenScaleX + proj.halfWidth,
+            (spaceY + proj.offsetMinusOne) * invDistance * proj.screenScaleY + proj.screenScaleY,
+            proj.sizeScale * invDistance
+        };
+    }
+}
+
+/**
+ * Convert an array of screen coordinates to world coordinates using the Mode 7 camera.
+ * The camera terms are computed once for the whole array and each point costs a single division.
+ *
+ * @param camera The Mode 7 camera.
+ * @param points The screen coordinates to convert.
+ * @param out The world coordinates, can be the same array as 'points'.
+ * @param count The number of coordinates to convert.
+ */
+void M7_ToWorldN(M7_Camera* camera, const Vector2* points, Vector2* out, size_t count)
+{
+    const M7_Projection proj = M7_Camera_GetProjection(camera);
+
+    for (size_t i = M7_ToWorld_SIMD(&proj, points, out, count); i < count; i++)
+    {
+        const float sx = (proj.halfWidth - points[i].x) * proj.worldScaleX;
+        const float sy = (proj.offsetHeight - points[i].y) * proj.worldScaleY;
+
+        const float invY = 1.0f / points[i].y;
+
+        out[i] = (Vector2) {
+            (sx * proj.rotMat.m0 + sy * proj.rotMat.m1) * invY + proj.camX,
+            (sx * proj.rotMat.m2 + sy * proj.rotMat.m3) * invY + proj.camY
+        };
+    }
+}
+
+/**
+ * Get the front-most element drawn by the last frame of the Mode 7 camera at a screen point.
+ * The draw list of the frame is binned in screen cells on the first pick that follows it,
+ * so that each pick only tests the elements overlapping the cell of its point.
+ * The whole rectangle of the textures is hit, whatever the alpha of their texels (see M7_Camera_PickPixel).
+ *
+ * @param camera The Mode 7 camera.
+ * @param point The screen point, in target pixels like M7_ToWorld().
+ *
+ * @return The front-most element at the point, or NULL if there is none.
+ */
+M7_Element* M7_Camera_Pick(M7_Camera* camera, Vector2 point)
+{
+    uint32_t count;
+    const uint32_t *entries = M7_Pick_GetCell(camera, point, &count);
+
+    M7_ZBuffer *buffer = &camera->world->buffer;
+    const M7_ZBuffer_View *view = camera->view;
+    M7_ZBuffer_Element *hit = NULL;
+
+    // The entries are in drawing order, so the last of the nearest elements is the one on top
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        M7_ZBuffer_Element *elem = buffer->elems[view->order[entries[i]].index];
+
+        if ((!hit || view->distance[elem->index] >= view->distance[hit->index]) && M7_ZBuffer_Element_Contains(view, elem, point))
+        {
+            hit = elem;
+        }
+    }
+
+    return hit;
+}
+
+/**
+ * Get the front-most elements drawn by the last frame of the Mode 7 camera at an array of screen points.
+ *
+ * @param camera The Mode 7 camera.
+ * @param points The screen points, in target pixels like M7_ToWorld().
+ * @param out The front-most element at each point, or NULL where there is none.
+ * @param count The number of points.
+ */
+void M7_Camera_PickN(M7_Camera* camera, const Vector2* points, M7_Element** out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = M7_Camera_Pick(camera, points[i]);
+    }
+}
+
+/**
+ * Get the front-most element drawn by the last frame of the Mode 7 camera at a screen point, pixel exact.
+ * The elements overlapping the point are drawn with their identifiers in a target of a single pixel,
+ * skipping the texels with an alpha below M7_PICK_ALPHA_CUTOFF, and the pixel is read back.
+ * This stalls until the GPU has drawn them, and must not be called between M7_Camera_Begin() and M7_Camera_End().
+ * The software cameras fall back to M7_Camera_Pick().
+ *
+ * @param camera The Mode 7 camera.
+ * @param point The screen point, in target pixels like M7_ToWorld().
+ *
+ * @return The front-most element at the point, or NULL if there is none.
+ */
+M7_Element* M7_Camera_PickPixel(M7_Camera* camera, Vector2 point)
+{
+    if (camera->software.enabled) return M7_Camera_Pick(camera, point);
+
+    uint32_t count;
+    const uint32_t *entries = M7_Pick_GetCell(camera, point, &count);
+
+    M7_ZBuffer *buffer = &camera->world->buffer;
+    const M7_ZBuffer_View *view = camera->view;
+
+    // Candidates whose shape covers the point, sorted from the farthest to the nearest
+    // (the insertion keeps the drawing order between the elements at the same distance)
+
+    if (count == 0) return NULL;
+
+    uint32_t *candidates = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t candidateCount = 0;
+
+    if (!candidates) return NULL;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t index = view->order[entries[i]].index;
+        if (!M7_ZBuffer_Element_Contains(view, buffer->elems[index], point)) continue;
+
+        uint32_t j = candidateCount++;
+
+        while (j > 0 && view->distance[view->order[candidates[j - 1]].index] > view->distance[index])
+        {
+            candidates[j] = candidates[j - 1], j--;
+        }
+
+        candidates[j] = entries[i];
+    }
+
+    if (candidateCount == 0)
+    {
+        free(candidates);
+        return NULL;
+    }
+
+    if (camera->pick.target.id == 0)
+    {
+        camera->pick.target = LoadRenderTexture(1, 1);
+    }
+
+    // Each candidate is drawn with its number as tint, the point being moved to the center of the pixel
+
+    BeginTextureMode(camera->pick.target);
+    ClearBackground(BLANK);
+
+    rlPushMatrix();
+    rlTranslatef(0.5f - point.x, 0.5f - point.y, 0.0f);
+
+    BeginShaderMode(camera->programs->pickProgram.shader);
+
+        for (uint32_t i = 0; i < candidateCount; i++)
+        {
+            M7_ZBuffer_Element elem = *buffer->elems[view->order[candidates[i]].index];
+            const uint32_t id = i + 1;
+
+            elem.tint = (Color) { id & 0xFF, (id >> 8) & 0xFF, (id >> 16) & 0xFF, 255 };
+            M7_ZBuffer_Element_Draw(view, &elem);
+        }
+
+    EndShaderMode();
+
+    rlPopMatrix();
+    EndTextureMode();
+
+    // The identifier of the element on top is read back (0 where none has been drawn)
+
+    M7_ZBuffer_Element *hit = NULL;
+    Image image = LoadImageFromTexture(camera->pick.target.texture);
+
+    if (image.data)
+    {
+        const unsigned char *pixel = (const unsigned char*)image.data;
+        const uint32_t id = pixel[0] | (pixel[1] << 8) | ((uint32_t)pixel[2] << 16);
+
+        if (id > 0 && id <= candidateCount)
+        {
+            hit = buffer->elems[view->order[candidates[id - 1]].index];
+        }
+
+        UnloadImage(image);
+    }
+
+    free(candidates);
+
+    return hit;
+}
+
+/*
+    Element management functions rendering of world space in perspective
+*/
+
+/**
+ * Add a textured element to the Mode 7 camera's world space in perspective.
+ *
+ * @param camera The Mode 7 camera.
+ * @param texture The texture to add.
+ * @param source The source rectangle of the texture.
+ * @param position The position of the element.
+ * @param scale The scale of the element.
+ * @param tint The tint color of the element.
+ *
+ * @return A pointer to the added Mode 7 element.
+ */
+M7_Element* M7_Texture_Add(M7_Camera* camera, Texture2D texture, Rectangle source, Vector2 position, Vector2 scale, Color tint)
+{
+    M7_ZBuffer_Element tex = {
+        
+        .onWorld = (struct M7_ZBuffer_Element_SpaceData) {
+            .rectangle = source,
+            .position = position,
+            .scale = scale
+        },
+
+        .type = M7_ZBT_TEXTURE,
+        .texture = texture,
+        .tint = tint
+    };
+
+    return M7_ZBuffer_Element_Add(&camera->world->buffer, &tex);
+}
+
+/**
+ * Add a rectangle element to the Mode 7 camera's world space in perspective.
+ *
+ * @param camera The Mode 7 camera.
+ * @param rectangle The rectangle to add.
+ * @param tint The tint color of the element.
+ *
+ * @return A pointer to the added Mode 7 element.
+ */
+M7_Element* M7_Rectangle_Add(M7_Camera* camera, Rectangle rectangle, Color tint)
+{
+    M7_ZBuffer_Element rect = {
+        
+        .onWorld = (struct M7_ZBuffer_Element_SpaceData) {
+            .rectangle = (Rectangle) { rectangle.x, rectangle.y, 1.0f, 1.0f },
+            .position = (Vector2) { rectangle.x, rectangle.y },
+            .scale = (Vector2) { rectangle.width, rectangle.height }
+        },
+
+        .type = M7_ZBT_RECTANGLE,
+        .tint = tint
+    };
+
+    return M7_ZBuffer_Element_Add(&camera->world->buffer, &rect);
+}
+
+/**
+ * Add a circle element to the Mode 7 camera's world space in perspective.
+ *
+ * @param camera The Mode 7 camera.
+ * @param position The position of the circle.
+ * @param radius The radius of the circle.
+ * @param tint The tint color of the element.
+ *
+ * @return A pointer to the added Mode 7 element.
+ */
+M7_Element* M7_Circle_Add(M7_Camera* camera, Vector2 position, float radius, Color tint)
+{
+    M7_ZBuffer_Element circle = {
+        
+        .onWorld = (struct M7_ZBuffer_Element_SpaceData) {
+
+            .rectangle = (Rectangle) {
+                position.x - radius,
+                position.y - radius,
+                1.0f, 1.0f
+            },
+
+            .position = position,
+            .scale = (Vector2) { radius, radius }
+
+        },
+
+        .type = M7_ZBT_CIRCLE,
+        .tint = tint
+    };
+
+    return M7_ZBuffer_Element_Add(&camera->world->buffer, &circle);
+}
+
+/**
+ * Remove an element from the Mode 7 camera's world space.
+ * The memory of the element can be reused by the next added elements,
+ * use handles to keep references that can be checked after a removal.
+ *
+ * @param camera The Mode 7 camera.
+ * @param elem The element to remove.
+ *
+ * @return True if the element has been removed, false if it had already been removed.
+ */
+bool M7_Element_Remove(M7_Camera* camera, M7_Element* elem)
+{
+    return M7_ZBuffer_Element_Remove(&camera->world->buffer, elem);
+}
+
+/**
+ * Get the handle of an element.
+ *
+ * @param elem The element.
+ *
+ * @return The handle referencing the element.
+ */
+M7_Handle M7_Element_GetHandle(const M7_Element* elem)
+{
+    return (M7_Handle) { elem->slot, elem->generation };
+}
+
+/**
+ * Get the element referenced by a handle.
+ *
+ * @param camera The Mode 7 camera.
+ * @param handle The handle of the element.
+ *
+ * @return A pointer to the element, or NULL if it has been removed.
+ */
+M7_Element* M7_Element_FromHandle(M7_Camera* camera, M7_Handle handle)
+{
+    M7_ZBuffer_Element *elem = M7_ZBuffer_Element_Get(&camera->world->buffer, handle.slot);
+    if (!elem || !elem->alive || elem->generation != handle.generation) return NULL;
+    return elem;
+}
+
+/**
+ * Set the world position of an element and mark it as dirty.
+ *
+ * @param elem The element to modify.
+ * @param position The new world position.
+ */
+void M7_Element_SetPosition(M7_Element* elem, Vector2 position)
+{
+    elem->onWorld.position = position;
+    M7_ZBuffer_Element_Touch(elem);
+}
+
+/**
+ * Set the world scale of an element and mark it as dirty.
+ *
+ * @param elem The element to modify.
+ * @param scale The new world scale.
+ */
+void M7_Element_SetScale(M7_Element* elem, Vector2 scale)
+{
+    elem->onWorld.scale = scale;
+    M7_ZBuffer_Element_Touch(elem);
+}
+
+/**
+ * Mark an element as dirty so that it is projected again on the next frame in retained mode.
+ * To call after modifying the 'onWorld' fields of an element directly.
+ *
+ * @param elem The element to mark.
+ */
+void M7_Element_MarkDirty(M7_Element* elem)
+{
+    M7_ZBuffer_Element_Touch(elem);
+}
+
+/*
+    Tilemap management functions
+*/
+
+/**
+ * Load a tilemap whose tiles are taken from an atlas texture.
+ *
+ * @param atlas The atlas texture containing the tiles (not owned by the tilemap).
+ * @param tileWidth The width of a tile in the atlas (in pixels).
+ * @param tileHeight The height of a tile in the atlas (in pixels).
+ * @param width The width of the map (in tiles).
+ * @param height The height of the map (in tiles).
+ * @param tiles The atlas tile indices of the map, row by row (can be NULL for an empty map).
+ *
+ * @return The loaded tilemap.
+ */
+M7_Tilemap M7_Tilemap_Load(Texture2D atlas, int tileWidth, int tileHeight, int width, int height, const int* tiles)
+{
+    M7_Tilemap tilemap = {0};
+
+    tilemap.atlas = atlas;
+    tilemap.tileWidth = tileWidth;
+    tilemap.tileHeight = tileHeight;
+    tilemap.width = width;
+    tilemap.height = height;
+
+    tilemap.tiles = (float*)malloc(width * height * sizeof(float));
+
+    for (int i = 0; i < width * height; i++)
+    {
+        tilemap.tiles[i] = tiles ? (float)tiles[i] : -1.0f;
+    }
+
+    tilemap.indices = LoadTextureFromImage((Image) {
+        .data = tilemap.tiles, .width = width, .height = height,
+        .mipmaps = 1, .format = PIXELFORMAT_UNCOMPRESSED_R32
+    });
+
+    return tilemap;
+}
+
+/**
+ * Unload a tilemap, freeing associated resources.
+ * The atlas texture is not unloaded.
+ *
+ * @param tilemap The tilemap to unload.
+ */
+void M7_Tilemap_Unload(M7_Tilemap* tilemap)
+{
+    UnloadTexture(tilemap->indices);
+    tilemap->indices.id = 0;
+
+    if (tilemap->tiles)
+    {
+        free(tilemap->tiles);
+        tilemap->tiles = NULL;
+    }
+
+    tilemap->width = tilemap->height = 0;
+}
+
+/**
+ * Set the atlas tile index of a map tile.
+ * The change is uploaded on the next call to M7_Camera_DrawTilemap().
+ *
+ * @param tilemap The tilemap to modify.
+ * @param x The X position of the tile in the map.
+ * @param y The Y position of the tile in the map.
+ * @param tile The atlas tile index (-1 for an empty tile).
+ */
+void M7_Tilemap_SetTile(M7_Tilemap* tilemap, int x, int y, int tile)
+{
+    if (x < 0 || y < 0 || x >= tilemap->width || y >= tilemap->height) return;
+
+    tilemap->tiles[y * tilemap->width + x] = (float)tile;
+    tilemap->dirty = true;
+}
+
+/**
+ * Get the atlas tile index of a map tile.
+ *
+ * @param tilemap The tilemap to read.
+ * @param x The X position of the tile in the map.
+ * @param y The Y position of the tile in the map.
+ *
+ * @return The atlas tile index, or -1 if the tile is empty or out of the map.
+ */
+int M7_Tilemap_GetTile(const M7_Tilemap* tilemap, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= tilemap->width || y >= tilemap->height) return -1;
+    return (int)tilemap->tiles[y * tilemap->width + x];
+}
+
+/*
+    Sprite atlas management functions
+*/
+
+/**
+ * Load a sprite atlas packing all the textures used by the texture elements of a camera,
+ * then make these elements use the atlas, with their source rectangles moved into its space.
+ * The sprites sorted by depth are then drawn in a single batch instead of one per texture switch.
+ *
+ * The pixels of the textures are read back from the GPU, so this is meant to be called at load time.
+ * The textures that do not fit into M7_SPRITE_ATLAS_MAX_SIZE are left unpacked, as are the elements using them.
+ * The source rectangles must stay within their texture (no repeat) and the atlas has no mipmaps,
+ * the filter of 'atlas.texture' can be set like the one of any texture.
+ *
+ * @param camera The camera whose texture elements are packed.
+ * @param padding The space left between the packed textures (in pixels), avoids bleeding with bilinear filtering.
+ *
+ * @return The loaded sprite atlas, whose texture is not valid (id 0) if there was nothing to pack.
+ */
+M7_SpriteAtlas M7_SpriteAtlas_Load(M7_Camera* camera, int padding)
+{
+    M7_SpriteAtlas atlas = { .padding = padding };
+    const M7_ZBuffer *buffer = &camera->world->buffer;
+
+    if (buffer->count == 0) return atlas;
+
+    // Gather the distinct textures of the elements
+
+    M7_SpriteAtlas_Entry *entries = (M7_SpriteAtlas_Entry*)malloc(buffer->count*sizeof(M7_SpriteAtlas_Entry));
+    if (!entries) return atlas;
+
+    int count = 0;
+    double area = 0.0;
+    int widest = 0;
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        const M7_ZBuffer_Element *elem = buffer->elems[i];
+        if (elem->type != M7_ZBT_TEXTURE || elem->texture.id == 0) continue;
+
+        const Texture2D texture = elem->texture;
+        if (texture.width + 2*padding > M7_SPRITE_ATLAS_MAX_SIZE || texture.height + 2*padding > M7_SPRITE_ATLAS_MAX_SIZE) continue;
+
+        int j = 0;
+        while (j < count && entries[j].source.id != texture.id) j++;
+        if (j < count) continue;
+
+        entries[count++] = (M7_SpriteAtlas_Entry) { .source = texture };
+        area += (double)(texture.width + padding) * (texture.height + padding);
+        if (texture.width + padding > widest) widest = texture.width + padding;
+    }
+
+    if (count == 0)
+    {
+        free(entries);
+        return atlas;
+    }
+
+    // Pack the tallest textures first on shelves, starting from the smallest power of two width
+    // that can hold them and doubling it while the atlas is taller than wide
+
+    qsort(entries, count, sizeof(M7_SpriteAtlas_Entry), M7_SpriteAtlas_Compare);
+
+    int width = 1;
+    while (width < M7_SPRITE_ATLAS_MAX_SIZE && ((double)width * width < area || width < widest + padding)) width *= 2;
+    if (width > M7_SPRITE_ATLAS_MAX_SIZE) width = M7_SPRITE_ATLAS_MAX_SIZE;
+
+    int height = M7_SpriteAtlas_Pack(entries, count, width, padding);
+
+    while (height > width && width < M7_SPRITE_ATLAS_MAX_SIZE)
+    {
+        width *= 2;
+        height = M7_SpriteAtlas_Pack(entries, count, width, padding);
+    }
+
+    // Keep the packed textures only (their width is left to zero when they did not fit)
+
+    for (int i = 0; i < count; i++)
+    {
+        if (entries[i].rect.width > 0) entries[atlas.count++] = entries[i];
+    }
+
+    if (atlas.count == 0)
+    {
+        free(entries);
+        return atlas;
+    }
+
+    atlas.entries = entries;
+
+    // Copy the pixels of the textures into the atlas
+
+    Image image = GenImageColor(width, height, BLANK);
+
+    for (int i = 0; i < atlas.count; i++)
+    {
+        Image source = LoadImageFromTexture(entries[i].source);
+        if (!source.data) continue;
+
+        ImageDraw(&image, source, (Rectangle) { 0, 0, (float)source.width, (float)source.height }, entries[i].rect, WHITE);
+        UnloadImage(source);
+    }
+
+    atlas.texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+
+    M7_SpriteAtlas_Apply(&atlas, camera);
+
+    return atlas;
+}
+
+/**
+ * Unload a sprite atlas, freeing associated resources.
+ * The packed textures are not unloaded, nor are the elements using the atlas modified.
+ *
+ * @param atlas The sprite atlas to unload.
+ */
+void M7_SpriteAtlas_Unload(M7_SpriteAtlas* atlas)
+{
+    if (atlas->texture.id > 0) UnloadTexture(atlas->texture);
+    atlas->texture.id = 0;
+
+    if (atlas->entries)
+    {
+        free(atlas->entries);
+        atlas->entries = NULL;
+    }
+
+    atlas->count = 0;
+}
+
+/**
+ * Make the texture elements of a camera using one of the packed textures use the atlas instead,
+ * for example for the elements added after the atlas has been loaded or to the cameras of another world.
+ * The elements already using the atlas are left untouched.
+ *
+ * @param atlas The sprite atlas.
+ * @param camera The camera whose elements are modified.
+ *
+ * @return The number of modified elements.
+ */
+int M7_SpriteAtlas_Apply(const M7_SpriteAtlas* atlas, M7_Camera* camera)
+{
+    const M7_ZBuffer *buffer = &camera->world->buffer;
+    if (atlas->texture.id == 0) return 0;
+
+    int modified = 0;
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        M7_ZBuffer_Element *elem = buffer->elems[i];
+        if (elem->type != M7_ZBT_TEXTURE || elem->texture.id == 0) continue;
+
+        for (int j = 0; j < atlas->count; j++)
+        {
+            if (atlas->entries[j].source.id != elem->texture.id) continue;
+
+            elem->texture = atlas->texture;
+            elem->onWorld.rectangle.x += atlas->entries[j].rect.x;
+            elem->onWorld.rectangle.y += atlas->entries[j].rect.y;
+
+            M7_ZBuffer_Element_Touch(elem);
+            modified++;
+            break;
+        }
+    }
+
+    return modified;
+}
+
+/**
+ * Comparison function ordering the textures of a sprite atlas from the tallest to the shortest.
+ *
+ * @param a Pointer to the first entry.
+ * @param b Pointer to the second entry.
+ *
+ * @return A negative value if 'a' is taller than 'b', positive if shorter, zero otherwise.
+ */
+static int M7_SpriteAtlas_Compare(const void* a, const void* b)
+{
+    const M7_SpriteAtlas_Entry *ea = (const M7_SpriteAtlas_Entry*)a;
+    const M7_SpriteAtlas_Entry *eb = (const M7_SpriteAtlas_Entry*)b;
+    return eb->source.height - ea->source.height;
+}
+
+/**
+ * Place the textures of a sprite atlas on shelves, from left to right and top to bottom.
+ * The textures that do not fit into M7_SPRITE_ATLAS_MAX_SIZE are given an empty rectangle.
+ *
+ * @param entries The textures to place, sorted from the tallest to the shortest.
+ * @param count The number of textures.
+ * @param width The width of the atlas (in pixels).
+ * @param padding The space left between the textures and around them (in pixels).
+ *
+ * @return The height of the atlas needed by the placed textures (in pixels).
+ */
+static int M7_SpriteAtlas_Pack(M7_SpriteAtlas_Entry* entries, int count, int width, int padding)
+{
+    int x = padding, y = padding;
+    int shelfHeight = 0;
+    int height = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const int w = entries[i].source.width;
+        const int h = entries[i].source.height;
+
+        if (x + w + padding > width)
+        {
+            x = padding;
+            y += shelfHeight + padding;
+            shelfHeight = 0;
+        }
+
+        if (x + w + padding > width || y + h + padding > M7_SPRITE_ATLAS_MAX_SIZE)
+        {
+            entries[i].rect = (Rectangle) { 0 };
+            continue;
+        }
+
+        entries[i].rect = (Rectangle) { (float)x, (float)y, (float)w, (float)h };
+
+        x += w + padding;
+        if (h > shelfHeight) shelfHeight = h;
+        if (y + h + padding > height) height = y + h + padding;
+    }
+
+    return height;
+}
+
+/*
+    Virtual texture management functions
+*/
+
+enum {
+    M7_PAGE_MISSING,    // The page is neither in the cache nor requested
+    M7_PAGE_QUEUED,     // The page has been gathered under the view on the current draw
+    M7_PAGE_REQUESTED,  // The page has been requested and not submitted yet
+    M7_PAGE_RESIDENT    // The page is in the cache
+};
+
+/**
+ * Load a virtual texture, a map whose pages are streamed in a cache of fixed size.
+ * The memory used does not depend on the content of the map, only on its size in pages
+ * (a few bytes per page) and on the size of the cache.
+ *
+ * When a page is needed under the view and neither resident nor requested, the request callback is
+ * called with its position in the map. The RGBA8 pixels of the page, of 'pageSize * pageSize' pixels
+ * (padded on the right and bottom edges of the map), must then be given to M7_VirtualTexture_SubmitPage(),
+ * directly from the callback or once they have been read on another thread. The submission uploads
+ * the page and must be done on the rendering thread.
+ *
+ * The cache must be able to hold all the pages under the view, the pages used by the last draw
+ * are never evicted, so the pages that do not fit are left missing.
+ *
+ * @param width The width of the map (in pixels).
+ * @param height The height of the map (in pixels).
+ * @param pageSize The size of a page (in pixels).
+ * @param cacheColumns The width of the cache (in pages, at most 256).
+ * @param cacheRows The height of the cache (in pages, at most 256).
+ * @param request The callback requesting the missing pages.
+ * @param userData The user data given to the callback.
+ *
+ * @return The loaded virtual texture, with a NULL 'table' if the size is invalid or an allocation failed.
+ */
+M7_VirtualTexture M7_VirtualTexture_Load(int width, int height, int pageSize, int cacheColumns, int cacheRows, M7_PageRequest request, void* userData)
+{
+    M7_VirtualTexture texture = {0};
+
+    if (width <= 0 || height <= 0 || pageSize <= 0) return texture;
+
+    // The slot of a page in the cache is stored in the 8 bit channels of the page table
+
+    cacheColumns = (cacheColumns < 1) ? 1 : (cacheColumns > 256) ? 256 : cacheColumns;
+    cacheRows = (cacheRows < 1) ? 1 : (cacheRows > 256) ? 256 : cacheRows;
+
+    texture.width = width;
+    texture.height = height;
+    texture.pageSize = pageSize;
+    texture.pagesX = (width + pageSize - 1) / pageSize;
+    texture.pagesY = (height + pageSize - 1) / pageSize;
+    texture.cacheColumns = cacheColumns;
+    texture.cacheRows = cacheRows;
+    texture.maxRequests = M7_VIRTUAL_MAX_REQUESTS;
+    texture.request = request;
+    texture.userData = userData;
+    texture.fallback = BLANK;
+
+    const uint32_t pageCount = (uint32_t)texture.pagesX * texture.pagesY;
+    const uint32_t slotCount = (uint32_t)cacheColumns * cacheRows;
+
+    texture.table = (uint8_t*)calloc(pageCount, 4);
+    texture.states = (uint8_t*)calloc(pageCount, 1);
+    texture.candidates = (M7_PageCandidate*)malloc(pageCount * sizeof(M7_PageCandidate));
+    texture.slotPages = (uint32_t*)malloc(slotCount * sizeof(uint32_t));
+    texture.slotStamps = (uint32_t*)calloc(slotCount, sizeof(uint32_t));
+
+    if (!texture.table || !texture.states || !texture.candidates || !texture.slotPages || !texture.slotStamps)
+    {
+        M7_VirtualTexture_Unload(&texture);
+        return texture;
+    }
+
+    for (uint32_t i = 0; i < slotCount; i++)
+    {
+        texture.slotPages[i] = UINT32_MAX;
+    }
+
+    texture.pageTable = LoadTextureFromImage((Image) {
+        .data = texture.table, .width = texture.pagesX, .height = texture.pagesY,
+        .mipmaps = 1, .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    });
+
+    texture.cache = (Texture2D) {
+        .id = rlLoadTexture(NULL, cacheColumns * pageSize, cacheRows * pageSize, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1),
+        .width = cacheColumns * pageSize, .height = cacheRows * pageSize, .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+
+    return texture;
+}
+
+/**
+ * Unload a virtual texture, freeing associated resources.
+ * The pages requested and not submitted yet are dropped, they must not be submitted anymore.
+ *
+ * @param texture The virtual texture to unload.
+ */
+void M7_VirtualTexture_Unload(M7_VirtualTexture* texture)
+{
+    if (texture->cache.id) UnloadTexture(texture->cache);
+    if (texture->pageTable.id) UnloadTexture(texture->pageTable);
+
+    texture->cache.id = texture->pageTable.id = 0;
+
+    free(texture->table);
+    free(texture->states);
+    free(texture->candidates);
+    free(texture->slotPages);
+    free(texture->slotStamps);
+
+    texture->table = texture->states = NULL;
+    texture->candidates = NULL;
+    texture->slotPages = texture->slotStamps = NULL;
+
+    texture->width = texture->height = 0;
+    texture->pagesX = texture->pagesY = 0;
+}
+
+/**
+ * Submit the pixels of a page of a virtual texture, usually after it has been requested.
+ * The page is stored in a free slot of the cache, or in place of the page least recently under the view.
+ * The pages under the view on the last draw are never evicted, so when the cache is full of them the
+ * page is not stored and will be requested again on a later draw.
+ * A resident page can also be submitted again to update its content.
+ *
+ * @param texture The virtual texture to modify.
+ * @param pageX The X position of the page in the map (in pages).
+ * @param pageY The Y position of the page in the map (in pages).
+ * @param pixels The RGBA8 pixels of the page (NULL if it could not be loaded, it will then be requested again).
+ *
+ * @return True if the page has been stored in the cache, false otherwise.
+ */
+bool M7_VirtualTexture_SubmitPage(M7_VirtualTexture* texture, int pageX, int pageY, const void* pixels)
+{
+    if (!texture->table || pageX < 0 || pageY < 0 || pageX >= texture->pagesX || pageY >= texture->pagesY)
+    {
+        return false;
+    }
+
+    const uint32_t page = (uint32_t)pageY * texture->pagesX + pageX;
+    uint8_t *entry = texture->table + 4 * page;
+
+    if (!pixels)
+    {
+        if (texture->states[page] == M7_PAGE_REQUESTED) texture->states[page] = M7_PAGE_MISSING;
+        return false;
+    }
+
+    uint32_t slot = 0;
+
+    if (texture->states[page] == M7_PAGE_RESIDENT)
+    {
+        slot = entry[1] * texture->cacheColumns + entry[0];
+    }
+    else
+    {
+        // A free slot, otherwise the one least recently under the view
+
+        const uint32_t slotCount = (uint32_t)texture->cacheColumns * texture->cacheRows;
+
+        for (uint32_t i = 0; i < slotCount; i++)
+        {
+            if (texture->slotPages[i] == UINT32_MAX)
+            {
+                slot = i;
+                break;
+            }
+
+            if (texture->slotStamps[i] < texture->slotStamps[slot]) slot = i;
+        }
+
+        const uint32_t evicted = texture->slotPages[slot];
+
+        if (evicted != UINT32_MAX && texture->slotStamps[slot] == texture->frame)
+        {
+            texture->states[page] = M7_PAGE_MISSING;
+            return false;
+        }
+
+        if (evicted != UINT32_MAX)
+        {
+            texture->states[evicted] = M7_PAGE_MISSING;
+            texture->table[4 * evicted + 3] = 0;
+        }
+
+        texture->slotPages[slot] = page;
+        texture->slotStamps[slot] = texture->frame;
+        texture->states[page] = M7_PAGE_RESIDENT;
+
+        entry[0] = (uint8_t)(slot % texture->cacheColumns);
+        entry[1] = (uint8_t)(slot / texture->cacheColumns);
+        entry[3] = 255;
+
+        texture->dirty = true;
+    }
+
+    UpdateTextureRec(texture->cache, (Rectangle) {
+        (float)((slot % texture->cacheColumns) * texture->pageSize),
+        (float)((slot / texture->cacheColumns) * texture->pageSize),
+        (float)texture->pageSize, (float)texture->pageSize
+    }, pixels);
+
+    return true;
+}
+
+/*
+    Asset loader management functions
+*/
+
+/**
+ * Load an asset loader, which decodes the textures on worker threads and uploads them in slices,
+ * so that the camera can be rendered right away and the level is filled as the textures arrive.
+ *
+ * The request callback is called on the rendering thread for each new asset by M7_Loader_Update().
+ * It should pass the asset to a worker thread calling M7_Asset_Decode(), then call M7_Loader_Submit()
+ * on the rendering thread once the decoding is done. Without a callback, one asset is decoded
+ * per update on the rendering thread, which still spreads the loading over several frames.
+ *
+ * The pixels are uploaded through a pixel unpack buffer, without waiting for the GPU to read them.
+ *
+ * @param uploadBudget The number of bytes of pixels uploaded per update (0 for M7_LOADER_UPLOAD_BUDGET).
+ * @param request The callback asking for the decoding of the assets (can be NULL).
+ * @param userData The user data given to the request callback.
+ *
+ * @return The loaded asset loader.
+ */
+M7_Loader M7_Loader_Load(size_t uploadBudget, M7_AssetRequest request, void* userData)
+{
+    M7_Loader loader = {
+        .request = request,
+        .userData = userData,
+        .uploadBudget = uploadBudget > 0 ? uploadBudget : M7_LOADER_UPLOAD_BUDGET,
+        .fallback = (Color) { 128, 128, 128, 255 }
+    };
+
+    glGenBuffers(1, &loader.pbo);
+
+    return loader;
+}
+
+/**
+ * Unload an asset loader, freeing associated resources.
+ * The textures of the assets are unloaded too, so the elements using them must be removed before.
+ * No asset must be being decoded by a worker thread.
+ *
+ * @param loader The asset loader to unload.
+ */
+void M7_Loader_Unload(M7_Loader* loader)
+{
+    for (int i = 0; i < loader->count; i++)
+    {
+        M7_Asset *asset = loader->assets[i];
+
+        if (asset->uploaded.id > 0) UnloadTexture(asset->uploaded);
+        if (asset->placeholder.id > 0) UnloadTexture(asset->placeholder);
+        if (asset->image.data) UnloadImage(asset->image);
+
+        free(asset->fileName);
+        free(asset);
+    }
+
+    free(loader->assets);
+    loader->assets = NULL;
+    loader->count = loader->capacity = 0;
+
+    if (loader->pbo) glDeleteBuffers(1, &loader->pbo);
+    loader->pbo = 0;
+}
+
+/**
+ * Add an asset to load to an asset loader.
+ * Its texture can be drawn right away: until the asset is ready it is a placeholder of a single texel,
+ * so the source rectangles of the elements using it are given in fractions of the texture
+ * (e.g. { 0, 0, 1, 1 } for the whole texture) and are scaled to its pixels by M7_Loader_Apply().
+ * The planes drawn with 'asset->texture' use the loaded texture as soon as it is ready.
+ *
+ * @param loader The asset loader.
+ * @param fileName The image file of the asset (copied).
+ * @param mipmaps Generate the mipmaps of the texture once uploaded.
+ *
+ * @return A pointer to the added asset, or NULL if the allocation failed.
+ */
+M7_Asset* M7_Loader_Add(M7_Loader* loader, const char* fileName, bool mipmaps)
+{
+    if (loader->count == loader->capacity)
+    {
+        const int capacity = loader->capacity > 0 ? 2*loader->capacity : 16;
+
+        M7_Asset **assets = (M7_Asset**)realloc(loader->assets, capacity*sizeof(M7_Asset*));
+        if (!assets) return NULL;
+
+        loader->assets = assets;
+        loader->capacity = capacity;
+    }
+
+    M7_Asset *asset = (M7_Asset*)calloc(1, sizeof(M7_Asset));
+    if (!asset) return NULL;
+
+    asset->fileName = (char*)malloc(strlen(fileName) + 1);
+
+    if (!asset->fileName)
+    {
+        free(asset);
+        return NULL;
+    }
+
+    strcpy(asset->fileName, fileName);
+
+    asset->placeholder = (Texture2D) {
+        .id = rlLoadTexture(&loader->fallback, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1),
+        .width = 1, .height = 1, .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+
+    asset->texture = asset->placeholder;
+    asset->mipmaps = mipmaps;
+
+    loader->assets[loader->count++] = asset;
+
+    return asset;
+}
+
+/**
+ * Decode the pixels of an asset into RGBA8.
+ * This function makes no GL call and only modifies the given asset, so it can be called from any thread,
+ * as long as M7_Loader_Submit() is only called for the asset once it has returned.
+ *
+ * @param asset The asset to decode.
+ *
+ * @return True if the pixels have been decoded, false otherwise.
+ */
+bool M7_Asset_Decode(M7_Asset* asset)
+{
+    Image image = LoadImage(asset->fileName);
+    if (!image.data) return false;
+
+    if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+    {
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    }
+
+    if (image.mipmaps > 1)
+    {
+        // Only the first level is uploaded, the mipmaps are generated on the GPU
+
+        image.mipmaps = 1;
+    }
+
+    asset->image = image;
+
+    return true;
+}
+
+/**
+ * Submit a decoded asset, which is then uploaded by the next updates of the loader.
+ * Must be called on the rendering thread once M7_Asset_Decode() has returned.
+ *
+ * @param loader The asset loader of the asset.
+ * @param asset The decoded asset (failed if its pixels could not be decoded).
+ *
+ * @return False if the asset does not belong to the loader or is not being decoded, true otherwise.
+ */
+bool M7_Loader_Submit(M7_Loader* loader, M7_Asset* asset)
+{
+    if (asset->state != M7_ASSET_QUEUED && asset->state != M7_ASSET_REQUESTED) return false;
+
+    // Only the assets of the loader are uploaded by its updates
+
+    int i = 0;
+    while (i < loader->count && loader->assets[i] != asset) i++;
+
+    if (i == loader->count) return false;
+
+    asset->state = asset->image.data ? M7_ASSET_DECODED : M7_ASSET_FAILED;
+
+    return true;
+}
+
+/**
+ * Update an asset loader, to call once per frame on the rendering thread (outside of the texture modes).
+ * The new assets are requested, then the decoded ones are uploaded within the upload budget,
+ * the texture of an asset becoming its loaded texture once all its rows have been uploaded.
+ *
+ * @param loader The asset loader to update.
+ *
+ * @return The number of assets that became ready, whose elements can then be updated with M7_Loader_Apply().
+ */
+int M7_Loader_Update(M7_Loader* loader)
+{
+    size_t budget = loader->uploadBudget;
+    bool decoded = false;
+    int ready = 0;
+
+    for (int i = 0; i < loader->count; i++)
+    {
+        M7_Asset *asset = loader->assets[i];
+
+        if (asset->state == M7_ASSET_QUEUED)
+        {
+            if (loader->request)
+            {
+                asset->state = M7_ASSET_REQUESTED;
+                loader->request(asset, loader->userData);
+            }
+            else if (!decoded)
+            {
+                M7_Asset_Decode(asset);
+                M7_Loader_Submit(loader, asset);
+                decoded = true;
+            }
+        }
+
+        if ((asset->state == M7_ASSET_DECODED || asset->state == M7_ASSET_UPLOADING) && budget > 0)
+        {
+            const size_t uploaded = M7_Loader_Upload(loader, asset, budget);
+            budget = uploaded < budget ? budget - uploaded : 0;
+
+            if (asset->state == M7_ASSET_READY) ready++;
+        }
+    }
+
+    return ready;
+}
+
+/**
+ * Make the texture elements of a camera using the placeholder of a ready asset use its loaded texture.
+ * Their source rectangles, given in fractions of the placeholder, are scaled to the pixels of the texture.
+ *
+ * @param loader The asset loader.
+ * @param camera The camera whose elements are modified.
+ *
+ * @return The number of modified elements.
+ */
+int M7_Loader_Apply(const M7_Loader* loader, M7_Camera* camera)
+{
+    const M7_ZBuffer *buffer = &camera->world->buffer;
+    int modified = 0;
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        M7_ZBuffer_Element *elem = buffer->elems[i];
+        if (elem->type != M7_ZBT_TEXTURE || elem->texture.id == 0) continue;
+
+        for (int j = 0; j < loader->count; j++)
+        {
+            const M7_Asset *asset = loader->assets[j];
+            if (asset->state != M7_ASSET_READY || asset->placeholder.id != elem->texture.id) continue;
+
+            const float sx = (float)asset->texture.width;
+            const float sy = (float)asset->texture.height;
+
+            elem->texture = asset->texture;
+            elem->onWorld.rectangle.x *= sx;
+            elem->onWorld.rectangle.y *= sy;
+            elem->onWorld.rectangle.width *= sx;
+            elem->onWorld.rectangle.height *= sy;
+
+            M7_ZBuffer_Element_Touch(elem);
+            modified++;
+            break;
+        }
+    }
+
+    return modified;
+}
+
+/**
+ * Check whether all the assets of a loader are ready or have failed.
+ *
+ * @param loader The asset loader.
+ *
+ * @return True if no asset is still being loaded, false otherwise.
+ */
+bool M7_Loader_IsDone(const M7_Loader* loader)
+{
+    for (int i = 0; i < loader->count; i++)
+    {
+        const M7_AssetState state = loader->assets[i]->state;
+        if (state != M7_ASSET_READY && state != M7_ASSET_FAILED) return false;
+    }
+
+    return true;
+}
+
+/*
+    Scene management functions
+*/
+
+/**
+ * Load a scene file, which is memory mapped when the platform allows it (see M7_NO_MMAP) or read into memory otherwise.
+ * The records are then used in place by M7_Scene_Instantiate(), without being parsed nor copied beforehand.
+ *
+ * @param fileName The scene file to load.
+ *
+ * @return The loaded scene, whose header is NULL if the file could not be loaded or is not a valid scene.
+ */
+M7_Scene M7_Scene_Load(const char* fileName)
+{
+    M7_Scene scene = { 0 };
+
+#ifdef M7_SCENE_MMAP
+    const int fd = open(fileName, O_RDONLY);
+
+    if (fd >= 0)
+    {
+        struct stat st;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (data != MAP_FAILED)
+            {
+                scene.data = data;
+                scene.size = (size_t)st.st_size;
+                scene.mapped = true;
+            }
+        }
+
+        close(fd);
+    }
+#endif
+
+    if (!scene.data)
+    {
+        int size = 0;
+        scene.data = LoadFileData(fileName, &size);
+        scene.size = size > 0 ? (size_t)size : 0;
+    }
+
+    if (!scene.data) return scene;
+
+    // The sizes are checked before any record is read
+
+    const M7_SceneHeader *header = (const M7_SceneHeader*)scene.data;
+
+    if (scene.size < sizeof(M7_SceneHeader) || memcmp(header->magic, "M7SC", 4) != 0 || header->version != M7_SCENE_VERSION
+        || (scene.size - sizeof(M7_SceneHeader)) / M7_SCENE_NAME_SIZE < header->textureCount
+        || (scene.size - sizeof(M7_SceneHeader) - (size_t)header->textureCount * M7_SCENE_NAME_SIZE) / sizeof(M7_SceneRecord) < header->elementCount)
+    {
+        M7_Scene_Unload(&scene);
+        return scene;
+    }
+
+    scene.header = header;
+    scene.names = (const char*)scene.data + sizeof(M7_SceneHeader);
+    scene.records = (const M7_SceneRecord*)(scene.names + (size_t)header->textureCount * M7_SCENE_NAME_SIZE);
+
+    return scene;
+}
+
+/**
+ * Unload a scene file, freeing associated resources.
+ * The elements added from the scene are not modified.
+ *
+ * @param scene The scene to unload.
+ */
+void M7_Scene_Unload(M7_Scene* scene)
+{
+    if (scene->data)
+    {
+#ifdef M7_SCENE_MMAP
+        if (scene->mapped) munmap(scene->data, scene->size);
+        else UnloadFileData((unsigned char*)scene->data);
+#else
+        UnloadFileData((unsigned char*)scene->data);
+#endif
+    }
+
+    *scene = (M7_Scene) { 0 };
+}
+
+/**
+ * Get the name of a texture reference of a scene, e.g. to load the textures given to M7_Scene_Instantiate().
+ *
+ * @param scene The scene.
+ * @param index The index of the texture reference.
+ *
+ * @return The name of the texture reference, or NULL if the index is out of the scene.
+ */
+const char* M7_Scene_GetTextureName(const M7_Scene* scene, int index)
+{
+    if (!scene->header || index < 0 || (uint32_t)index >= scene->header->textureCount) return NULL;
+    return scene->names + (size_t)index * M7_SCENE_NAME_SIZE;
+}
+
+/**
+ * Add all the elements of a scene to the world of a camera.
+ * The buffer is grown once for all the elements, which are then filled directly from the records.
+ * The spatial index of the scene, if any, is enabled before the elements are added, unless the camera already has one.
+ *
+ * @param scene The scene whose elements are added.
+ * @param camera The camera to which the elements are added.
+ * @param textures The texture of each texture reference of the scene (e.g. a sprite atlas repeated for all of them).
+ *
+ * @return The number of added elements (the records of unknown type or texture reference are skipped).
+ */
+uint32_t M7_Scene_Instantiate(const M7_Scene* scene, M7_Camera* camera, const Texture2D* textures)
+{
+    if (!scene->header) return 0;
+
+    M7_ZBuffer *buffer = &camera->world->buffer;
+    const M7_SceneHeader *header = scene->header;
+
+    if (header->cellSize > 0.0f && !buffer->grid)
+    {
+        M7_Camera_EnableSpatialIndex(camera, header->cellSize);
+    }
+
+    if (buffer->freeCount < header->elementCount)
+    {
+        const uint32_t missing = header->elementCount - buffer->freeCount;
+        if (!M7_ZBuffer_Grow(buffer, (missing + M7_POOL_CHUNK_SIZE - 1) / M7_POOL_CHUNK_SIZE)) return 0;
+    }
+
+    uint32_t added = 0;
+
+    for (uint32_t i = 0; i < header->elementCount; i++)
+    {
+        const M7_SceneRecord *record = &scene->records[i];
+
+        M7_ZBuffer_Element elem = {
+
+            .onWorld = (struct M7_ZBuffer_Element_SpaceData) {
+                .rectangle = (Rectangle) { record->rectangle[0], record->rectangle[1], record->rectangle[2], record->rectangle[3] },
+                .position = (Vector2) { record->position[0], record->position[1] },
+                .scale = (Vector2) { record->scale[0], record->scale[1] }
+            },
+
+            .type = (enum M7_ZBuffer_Element_Type)record->type,
+            .tint = (Color) { record->tint[0], record->tint[1], record->tint[2], record->tint[3] }
+        };
+
+        if (record->type == M7_ZBT_TEXTURE)
+        {
+            if (record->texture >= header->textureCount) continue;
+            elem.texture = textures[record->texture];
+        }
+        else if (record->type != M7_ZBT_RECTANGLE && record->type != M7_ZBT_CIRCLE)
+        {
+            continue;
+        }
+
+        if (M7_ZBuffer_Element_Add(buffer, &elem)) added++;
+    }
+
+    return added;
+}
+
+/**
+ * Save the elements of the world of a camera into a scene file.
+ * Each texture element is given the reference of its texture in 'textures', those whose texture is not in it are skipped.
+ *
+ * @param fileName The scene file to write.
+ * @param camera The camera whose elements are saved.
+ * @param textures The textures of the texture references.
+ * @param names The names of the texture references (truncated to M7_SCENE_NAME_SIZE - 1 characters, can be NULL).
+ * @param textureCount The number of texture references.
+ * @param cellSize The cell size of the spatial index enabled when the scene is instantiated (0 for none).
+ *
+ * @return True if the file has been written, false otherwise.
+ */
+bool M7_Scene_Export(const char* fileName, M7_Camera* camera, const Texture2D* textures, const char** names, int textureCount, float cellSize)
+{
+    const M7_ZBuffer *buffer = &camera->world->buffer;
+    if (textureCount < 0 || textureCount > UINT16_MAX) return false;
+
+    const size_t recordsOffset = sizeof(M7_SceneHeader) + (size_t)textureCount * M7_SCENE_NAME_SIZE;
+    const size_t size = recordsOffset + (size_t)buffer->count * sizeof(M7_SceneRecord);
+    if (size > INT32_MAX) return false;
+
+    unsigned char *data = (unsigned char*)calloc(1, size);
+    if (!data) return false;
+
+    M7_SceneHeader *header = (M7_SceneHeader*)data;
+    memcpy(header->magic, "M7SC", 4);
+    header->version = M7_SCENE_VERSION;
+    header->textureCount = (uint32_t)textureCount;
+    header->cellSize = cellSize;
+
+    for (int i = 0; names && i < textureCount; i++)
+    {
+        if (names[i]) strncpy((char*)data + sizeof(M7_SceneHeader) + (size_t)i * M7_SCENE_NAME_SIZE, names[i], M7_SCENE_NAME_SIZE - 1);
+    }
+
+    M7_SceneRecord *records = (M7_SceneRecord*)(data + recordsOffset);
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        const M7_ZBuffer_Element *elem = buffer->elems[i];
+        int texture = 0;
+
+        if (elem->type == M7_ZBT_TEXTURE)
+        {
+            while (texture < textureCount && textures[texture].id != elem->texture.id) texture++;
+            if (texture == textureCount) continue;
+        }
+
+        records[header->elementCount++] = (M7_SceneRecord) {
+            .position = { elem->onWorld.position.x, elem->onWorld.position.y },
+            .scale = { elem->onWorld.scale.x, elem->onWorld.scale.y },
+            .rectangle = {
+                elem->onWorld.rectangle.x, elem->onWorld.rectangle.y,
+                elem->onWorld.rectangle.width, elem->onWorld.rectangle.height
+            },
+            .tint = { elem->tint.r, elem->tint.g, elem->tint.b, elem->tint.a },
+            .type = (uint16_t)elem->type,
+            .texture = (uint16_t)texture
+        };
+    }
+
+    const size_t written = recordsOffset + (size_t)header->elementCount * sizeof(M7_SceneRecord);
+    const bool saved = SaveFileData(fileName, data, (int)written);
+
+    free(data);
+
+    return saved;
+}
+
+/*
+    Snapshot management functions
+*/
+
+/**
+ * Load a snapshot, through which a simulation thread modifies the elements of a world while the rendering
+ * thread projects, sorts and draws the previous frame, without any lock.
+ *
+ * The simulation thread writes the elements by handle into its own buffer then publishes it at the end of
+ * each step. The rendering thread applies the buffer published last before M7_Camera_End(), only the records
+ * written since then modifying their elements. The three buffers are swapped with a single atomic exchange,
+ * so none of the threads ever waits for the other, the steps published in between two frames being merged.
+ *
+ * The elements are still added and removed on the rendering thread, the handles of the new elements being
+ * given to the simulation thread, and the records of the elements removed since are skipped.
+ *
+ * @param capacity The number of element slots reserved in each buffer (it grows when needed).
+ *
+ * @return The loaded snapshot.
+ */
+M7_Snapshot M7_Snapshot_Load(uint32_t capacity)
+{
+    M7_Snapshot snapshot = { 0 };
+
+    for (int i = 0; i < 3; i++)
+    {
+        M7_Snapshot_Reserve(&snapshot.buffers[i], capacity);
+    }
+
+    snapshot.back = 0;
+    snapshot.shared = 1;
+    snapshot.front = 2;
+
+    return snapshot;
+}
+
+/**
+ * Unload a snapshot, once neither thread uses it anymore.
+ *
+ * @param snapshot The snapshot to unload.
+ */
+void M7_Snapshot_Unload(M7_Snapshot* snapshot)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        free(snapshot->buffers[i].records);
+    }
+
+    free(snapshot->applied);
+
+    *snapshot = (M7_Snapshot) { 0 };
+}
+
+/**
+ * Set the world position of an element in the snapshot (simulation thread).
+ *
+ * @param snapshot The snapshot.
+ * @param handle The handle of the element.
+ * @param position The new world position.
+ *
+ * @return True if the position has been written, false if the records could not grow.
+ */
+bool M7_Snapshot_SetPosition(M7_Snapshot* snapshot, M7_Handle handle, Vector2 position)
+{
+    M7_SnapshotRecord *record = M7_Snapshot_Write(snapshot, handle, M7_SNAPSHOT_POSITION);
+    if (!record) return false;
+
+    record->position = position;
+
+    return true;
+}
+
+/**
+ * Set the world scale of an element in the snapshot (simulation thread).
+ *
+ * @param snapshot The snapshot.
+ * @param handle The handle of the element.
+ * @param scale The new world scale.
+ *
+ * @return True if the scale has been written, false if the records could not grow.
+ */
+bool M7_Snapshot_SetScale(M7_Snapshot* snapshot, M7_Handle handle, Vector2 scale)
+{
+    M7_SnapshotRecord *record = M7_Snapshot_Write(snapshot, handle, M7_SNAPSHOT_SCALE);
+    if (!record) return false;
+
+    record->scale = scale;
+
+    return true;
+}
+
+/**
+ * Set the world rectangle of an element in the snapshot, the source rectangle for the textures (simulation thread).
+ *
+ * @param snapshot The snapshot.
+ * @param handle The handle of the element.
+ * @param rectangle The new rectangle.
+ *
+ * @return True if the rectangle has been written, false if the records could not grow.
+ */
+bool M7_Snapshot_SetRectangle(M7_Snapshot* snapshot, M7_Handle handle, Rectangle rectangle)
+{
+    M7_SnapshotRecord *record = M7_Snapshot_Write(snapshot, handle, M7_SNAPSHOT_RECTANGLE);
+    if (!record) return false;
+
+    record->rectangle = rectangle;
+
+    return true;
+}
+
+/**
+ * Set the tint color of an element in the snapshot (simulation thread).
+ *
+ * @param snapshot The snapshot.
+ * @param handle The handle of the element.
+ * @param tint The new tint color.
+ *
+ * @return True if the tint has been written, false if the records could not grow.
+ */
+bool M7_Snapshot_SetTint(M7_Snapshot* snapshot, M7_Handle handle, Color tint)
+{
+    M7_SnapshotRecord *record = M7_Snapshot_Write(snapshot, handle, M7_SNAPSHOT_TINT);
+    if (!record) return false;
+
+    record->tint = tint;
+
+    return true;
+}
+
+/**
+ * Publish the elements written into the snapshot so far (simulation thread).
+ * The written buffer is swapped with the buffer published last, which is then
+ * brought up to date by copying the records just published.
+ *
+ * @param snapshot The snapshot.
+ */
+void M7_Snapshot_Publish(M7_Snapshot* snapshot)
+{
+    const M7_SnapshotBuffer *published = &snapshot->buffers[snapshot->back];
+    snapshot->back = M7_ATOMIC_EXCHANGE(&snapshot->shared, snapshot->back | M7_SNAPSHOT_FRESH) & 3;
+
+    // The published buffer is only read from now on, by both threads
+
+    M7_SnapshotBuffer *back = &snapshot->buffers[snapshot->back];
+
+    // If the buffer cannot grow, the records that do not fit are left out until they are written again
+    // (the revisions being unique, the records written again are never mistaken for ones already applied)
+
+    const uint32_t count = M7_Snapshot_Reserve(back, published->count) ? published->count : back->capacity;
+
+    if (count > 0) memcpy(back->records, published->records, count * sizeof(M7_SnapshotRecord));
+    back->count = count;
+}
+
+/**
+ * Apply the elements published last in the snapshot to the world of a camera (rendering thread).
+ * To call before M7_Camera_End(), once per world for the cameras sharing their elements.
+ * Only the records written since the last call modify their elements, which are marked as dirty.
+ *
+ * @param snapshot The snapshot.
+ * @param camera The Mode 7 camera whose world holds the elements.
+ *
+ * @return The number of modified elements.
+ */
+uint32_t M7_Snapshot_Apply(M7_Snapshot* snapshot, M7_Camera* camera)
+{
+    if (M7_ATOMIC_LOAD(&snapshot->shared) & M7_SNAPSHOT_FRESH)
+    {
+        snapshot->front = M7_ATOMIC_EXCHANGE(&snapshot->shared, snapshot->front) & 3;
+        snapshot->pending = true;
+    }
+
+    if (!snapshot->pending) return 0;
+
+    const M7_SnapshotBuffer *front = &snapshot->buffers[snapshot->front];
+
+    if (front->count > snapshot->appliedCapacity)
+    {
+        uint32_t *applied = (uint32_t*)realloc(snapshot->applied, front->count * sizeof(uint32_t));
+        if (!applied) return 0;
+
+        memset(applied + snapshot->appliedCapacity, 0, (front->count - snapshot->appliedCapacity) * sizeof(uint32_t));
+
+        snapshot->applied = applied;
+        snapshot->appliedCapacity = front->count;
+    }
+
+    uint32_t modified = 0;
+
+    for (uint32_t slot = 0; slot < front->count; slot++)
+    {
+        const M7_SnapshotRecord *record = &front->records[slot];
+        if (record->revision == snapshot->applied[slot]) continue;
+
+        snapshot->applied[slot] = record->revision;
+
+        M7_ZBuffer_Element *elem = M7_Element_FromHandle(camera, record->handle);
+        if (!elem) continue;
+
+        if (record->fields & M7_SNAPSHOT_POSITION) elem->onWorld.position = record->position;
+        if (record->fields & M7_SNAPSHOT_SCALE) elem->onWorld.scale = record->scale;
+        if (record->fields & M7_SNAPSHOT_RECTANGLE) elem->onWorld.rectangle = record->rectangle;
+        if (record->fields & M7_SNAPSHOT_TINT) elem->tint = record->tint;
+
+        M7_ZBuffer_Element_Touch(elem);
+        modified++;
+    }
+
+    snapshot->pending = false;
+
+    return modified;
+}
+
+/**
+ * Reserve the records of a snapshot buffer, the new records being cleared.
+ *
+ * @param buffer The snapshot buffer.
+ * @param count The number of records needed.
+ *
+ * @return True if the buffer can hold the records, false if the allocation failed.
+ */
+static bool M7_Snapshot_Reserve(M7_SnapshotBuffer* buffer, uint32_t count)
+{
+    if (count <= buffer->capacity) return true;
+
+    uint32_t capacity = (buffer->capacity > 0) ? buffer->capacity : M7_POOL_CHUNK_SIZE;
+    while (capacity < count) capacity *= 2;
+
+    M7_SnapshotRecord *records = (M7_SnapshotRecord*)realloc(buffer->records, capacity * sizeof(M7_SnapshotRecord));
+    if (!records) return false;
+
+    memset(records + buffer->capacity, 0, (capacity - buffer->capacity) * sizeof(M7_SnapshotRecord));
+
+    buffer->records = records;
+    buffer->capacity = capacity;
+
+    return true;
+}
+
+/**
+ * Get the record of an element in the buffer written by the simulation thread, for writing a field.
+ * The fields written since the element was given to the record are kept, those of a previous
+ * element of its slot are cleared.
+ *
+ * @param snapshot The snapshot.
+ * @param handle The handle of the element.
+ * @param field The field about to be written (see M7_Snapshot_Field).
+ *
+ * @return The record of the element, or NULL if the records could not grow.
+ */
+static M7_SnapshotRecord* M7_Snapshot_Write(M7_Snapshot* snapshot, M7_Handle handle, uint32_t field)
+{
+    M7_SnapshotBuffer *back = &snapshot->buffers[snapshot->back];
+    if (!M7_Snapshot_Reserve(back, handle.slot + 1)) return NULL;
+
+    if (handle.slot >= back->count) back->count = handle.slot + 1;
+
+    M7_SnapshotRecord *record = &back->records[handle.slot];
+
+    if (record->handle.slot != handle.slot || record->handle.generation != handle.generation)
+    {
+        record->handle = handle;
+        record->fields = 0;
+    }
+
+    record->fields |= field;
+    record->revision = ++snapshot->revision;
+
+    return record;
+}
+
+/*
+    Software backend management functions
+*/
+
+/**
+ * Load a Mode 7 camera rendering with the software backend.
+ * No GL object is created, so the camera can be used without any window. The view is rendered into
+ * 'camera.software.image' between M7_Camera_Begin() and M7_Camera_End(), with the planes drawn by
+ * M7_Camera_DrawPlaneImage() and the elements added with M7_Image_Add(), M7_Rectangle_Add() or M7_Circle_Add().
+ *
+ * @param screenWidth The width of the image.
+ * @param screenHeight The height of the image.
+ * @param position The camera's initial position.
+ * @param rotation The camera's initial rotation.
+ * @param zoom The camera's initial zoom.
+ * @param fov The camera's initial field of view.
+ * @param offset The camera's initial offset.
+ * @param maxSprites The initial capacity of the ZBuffer (it grows by chunks when needed).
+ *
+ * @return The initialized Mode 7 camera, with a NULL 'world' if an allocation failed.
+ */
+M7_Camera M7_Camera_LoadSoftware(int screenWidth, int screenHeight, Vector2 position, float rotation, float zoom, float fov, float offset, uint32_t maxSprites)
+{
+    M7_Camera camera = {0};
+
+    camera.aspect = (screenWidth > screenHeight)
+        ? ((float)screenWidth / (float)screenHeight)
+        : ((float)screenHeight / (float)screenWidth);
+
+    camera.world = M7_World_Load(maxSprites);
+    camera.view = camera.world ? M7_ZBuffer_View_Load(&camera.world->buffer) : NULL;
+
+    if (!camera.view)
+    {
+        M7_World_Release(camera.world);
+        return (M7_Camera) {0};
+    }
+
+    camera.software.enabled = true;
+
+    camera.software.image = (Image) {
+        .data = calloc((size_t)screenWidth * screenHeight, 4),
+        .width = screenWidth, .height = screenHeight, .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+
+    // Only the size of the target is used, by the projection
+
+    camera.target.texture.width = screenWidth;
+    camera.target.texture.height = screenHeight;
+
+    M7_Camera_ApplyResolutionScale(&camera, 1.0f);
+
+    camera.maxLod = M7_MAX_LOD;
+    camera.fogStart = INFINITY;
+    M7_Camera_SetFog(&camera, BLANK, INFINITY);
+
+    M7_Camera_SetPosition(&camera, position);
+    M7_Camera_SetRotation(&camera, rotation);
+    M7_Camera_SetOffset(&camera, offset);
+    M7_Camera_SetZoom(&camera, zoom);
+    M7_Camera_SetFOV(&camera, fov);
+
+    return camera;
+}
+
+/**
+ * Draw a plane from the pixels of an image with a camera of the software backend.
+ * The rows are shaded with the same projection and fog as M7_Camera_DrawPlane(), the texels being point sampled
+ * from the base level, and are spread over the parallel for callback of the camera (see M7_Camera_SetParallelFor).
+ *
+ * @param camera The camera to use for drawing.
+ * @param image The pixels of the plane (RGBA8, nothing is drawn with another format).
+ * @param position The position of the plane.
+ * @param origin The origin of the plane.
+ * @param scale The scale of the plane.
+ * @param wrap The wrap mode for the plane.
+ */
+void M7_Camera_DrawPlaneImage(M7_Camera* camera, const Image* image, Vector2 position, Vector2 origin, Vector2 scale, int wrap)
+{
+    if (!camera->software.enabled || !camera->software.image.data) return;
+    if (!image->data || image->width <= 0 || image->height <= 0 || image->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) return;
+
+    M7_STATS_TIME(statsStart);
+
+    M7_SoftwareData pass = {
+        .camera = camera,
+        .map = image,
+        .mapSize = { image->width * scale.x, image->height * scale.y },
+        .camPos = {
+            camera->position.x + position.x + origin.x,
+            camera->position.y + position.y + origin.y
+        },
+        .wrap = wrap
+    };
+
+    Rectangle bounds = { 0, 0, (float)camera->target.texture.width, (float)camera->target.texture.height };
+
+    if (!wrap && !camera->rowTable.scanlines && !M7_Camera_GetPlaneBounds(camera, (Rectangle) {
+            -(position.x + origin.x), -(position.y + origin.y),
+            pass.mapSize[0], pass.mapSize[1]
+        }, &bounds))
+    {
+        return;
+    }
+
+    // The bounds are given on the full size target, the pass covers the pixels of the viewport whose center is inside
+
+    M7_Camera_GetViewport(camera, &pass.width, &pass.height);
+
+    const float scaleX = (float)pass.width / camera->target.texture.width;
+    const float scaleY = (float)pass.height / camera->target.texture.height;
+
+    pass.x0 = (int)fmaxf(ceilf(bounds.x * scaleX - 0.5f), 0.0f);
+    pass.x1 = (int)fminf(ceilf((bounds.x + bounds.width) * scaleX - 0.5f), (float)pass.width);
+    pass.y0 = (int)fmaxf(ceilf(bounds.y * scaleY - 0.5f), 0.0f);
+    pass.y1 = (int)fminf(ceilf((bounds.y + bounds.height) * scaleY - 0.5f), (float)pass.height);
+
+    if (pass.x0 >= pass.x1 || pass.y0 >= pass.y1) return;
+
+    const uint32_t batchCount = (pass.y1 - pass.y0 + M7_SOFTWARE_BATCH_ROWS - 1) / M7_SOFTWARE_BATCH_ROWS;
+    M7_Camera_ParallelFor(camera, M7_Software_PlaneJob, &pass, batchCount);
+
+    M7_STATS_COUNT(camera, planePasses, 1);
+    M7_STATS_ADD(camera, M7_STAGE_PLANES, statsStart);
+}
+
+/**
+ * Add a texture element drawn from the pixels of an image by the software backend.
+ * The image is kept by pointer and must stay valid as long as the element is used.
+ *
+ * @param camera The camera to add the element to.
+ * @param image The pixels of the texture (RGBA8, the element is not drawn with another format).
+ * @param source The source rectangle in the image.
+ * @param position The world position of the element.
+ * @param scale The world scale of the element.
+ * @param tint The tint color of the element.
+ *
+ * @return The added element, or NULL if the buffer could not grow.
+ */
+M7_Element* M7_Image_Add(M7_Camera* camera, const Image* image, Rectangle source, Vector2 position, Vector2 scale, Color tint)
+{
+    M7_ZBuffer_Element tex = {
+
+        .onWorld = (struct M7_ZBuffer_Element_SpaceData) {
+            .rectangle = source,
+            .position = position,
+            .scale = scale
+        },
+
+        .type = M7_ZBT_TEXTURE,
+        .texture = (Texture2D) {
+            .width = image->width, .height = image->height,
+            .mipmaps = 1, .format = image->format
+        },
+        .image = image,
+        .tint = tint
+    };
+
+    return M7_ZBuffer_Element_Add(&camera->world->buffer, &tex);
+}
+
+#ifdef M7_STATS
+
+/*
+    Instrumentation functions (functions automatically called by the module with M7_STATS)
+*/
+
+/**
+ * Start the measures of a new frame.
+ * The timestamps of the set used by this frame were issued two frames ago, they are read only if they
+ * are already available, so the CPU never waits for the GPU (the GPU times are kept otherwise).
+ *
+ * @param camera The Mode 7 camera.
+ */
+static void M7_Stats_BeginFrame(M7_Camera* camera)
+{
+    M7_Stats *frame = &camera->stats.frame;
+    const int index = camera->stats.index;
+
+    memset(frame->cpuTime, 0, sizeof(frame->cpuTime));
+    frame->planePasses = frame->drawCalls = frame->batchedElements = 0;
+    frame->updatedElements = frame->drawnElements = 0;
+
+    if (camera->software.enabled || !camera->stats.pending[index]) return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(camera->stats.queries[index][2], GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (!available) return;
+
+    GLuint64 timestamps[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        glGetQueryObjectui64v(camera->stats.queries[index][i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    frame->gpuTime[M7_STAGE_PLANES] = (timestamps[1] - timestamps[0]) * 1e-9;
+    frame->gpuTime[M7_STAGE_DRAW] = (timestamps[2] - timestamps[1]) * 1e-9;
+
+    camera->stats.pending[index] = false;
+}
+
+/**
+ * Record a GPU timestamp of the current frame, once the commands batched by raylib have been submitted.
+ *
+ * @param camera The Mode 7 camera.
+ * @param query The timestamp to record (0 for the start of the planes, 1 for the start of the draw, 2 for its end).
+ */
+static void M7_Stats_Timestamp(M7_Camera* camera, int query)
+{
+    if (camera->software.enabled) return;
+
+    rlDrawRenderBatchActive();
+    glQueryCounter(camera->stats.queries[camera->stats.index][query], GL_TIMESTAMP);
+}
+
+/**
+ * Complete the measures of the current frame and switch to the other set of timestamps.
+ *
+ * @param camera The Mode 7 camera.
+ */
+static void M7_Stats_EndFrame(M7_Camera* camera)
+{
+    camera->stats.frame.drawnElements = camera->view->visibleCount;
+    camera->stats.last = camera->stats.frame;
+
+    if (camera->software.enabled) return;
+
+    camera->stats.pending[camera->stats.index] = true;
+    camera->stats.index ^= 1;
+}
+
+#endif // M7_STATS
+
+/*
+    Shader management functions (functions automatically called by the module)
+*/
+
+static M7_Programs *M7_SharedPrograms = NULL;
+
+/**
+ * Get the shaders of the module, loading them on the first call.
+ * The shaders are compiled once and shared by all the cameras, each call must be paired with M7_Programs_Release().
+ *
+ * @return The shared shaders, or NULL if the allocation failed.
+ */
+static M7_Programs* M7_Programs_Acquire(void)
+{
+    if (M7_SharedPrograms)
+    {
+        M7_SharedPrograms->refCount++;
+        return M7_SharedPrograms;
+    }
+
+    M7_Programs *programs = (M7_Programs*)calloc(1, sizeof(M7_Programs));
+    if (!programs) return NULL;
+
+    Shader shader = LoadShaderFromMemory(0, M7_PlaneFragment);
+    programs->planeProgram.shader = shader;
+
+    programs->planeProgram.locMapTex   = GetShaderLocation(shader, "map");
+    programs->planeProgram.locRowTable = GetShaderLocation(shader, "rowTable");
+    programs->planeProgram.mapSize     = M7_Uniform_Get(shader, "mapSize", SHADER_UNIFORM_VEC2);
+    programs->planeProgram.camPos      = M7_Uniform_Get(shader, "camPos", SHADER_UNIFORM_VEC2);
+    programs->planeProgram.wrap        = M7_Uniform_Get(shader, "wrap", SHADER_UNIFORM_INT);
+    programs->planeProgram.maxLod      = M7_Uniform_Get(shader, "maxLod", SHADER_UNIFORM_FLOAT);
+
+    M7_Shader_BindCameraBlock(shader);
+
+    shader = LoadShaderFromMemory(0, M7_TilemapFragment);
+    programs->tilemapProgram.shader = shader;
+
+    programs->tilemapProgram.locAtlasTex = GetShaderLocation(shader, "atlas");
+    programs->tilemapProgram.locTilesTex = GetShaderLocation(shader, "tiles");
+    programs->tilemapProgram.locRowTable = GetShaderLocation(shader, "rowTable");
+    programs->tilemapProgram.atlasSize   = M7_Uniform_Get(shader, "atlasSize", SHADER_UNIFORM_VEC2);
+    programs->tilemapProgram.tileSize    = M7_Uniform_Get(shader, "tileSize", SHADER_UNIFORM_VEC2);
+    programs->tilemapProgram.gridSize    = M7_Uniform_Get(shader, "gridSize", SHADER_UNIFORM_IVEC2);
+    programs->tilemapProgram.mapSize     = M7_Uniform_Get(shader, "mapSize", SHADER_UNIFORM_VEC2);
+    programs->tilemapProgram.camPos      = M7_Uniform_Get(shader, "camPos", SHADER_UNIFORM_VEC2);
+    programs->tilemapProgram.wrap        = M7_Uniform_Get(shader, "wrap", SHADER_UNIFORM_INT);
+    programs->tilemapProgram.maxLod      = M7_Uniform_Get(shader, "maxLod", SHADER_UNIFORM_FLOAT);
+
+    M7_Shader_BindCameraBlock(shader);
+
+    shader = LoadShaderFromMemory(0, M7_VirtualFragment);
+    programs->virtualProgram.shader = shader;
+
+    programs->virtualProgram.locCacheTex  = GetShaderLocation(shader, "cache");
+    programs->virtualProgram.locPageTable = GetShaderLocation(shader, "pageTable");
+    programs->virtualProgram.locRowTable  = GetShaderLocation(shader, "rowTable");
+    programs->virtualProgram.mapTexels    = M7_Uniform_Get(shader, "mapTexels", SHADER_UNIFORM_VEC2);
+    programs->virtualProgram.pageSize     = M7_Uniform_Get(shader, "pageSize", SHADER_UNIFORM_FLOAT);
+    programs->virtualProgram.fallback     = M7_Uniform_Get(shader, "fallbackColor", SHADER_UNIFORM_VEC4);
+    programs->virtualProgram.mapSize      = M7_Uniform_Get(shader, "mapSize", SHADER_UNIFORM_VEC2);
+    programs->virtualProgram.camPos       = M7_Uniform_Get(shader, "camPos", SHADER_UNIFORM_VEC2);
+    programs->virtualProgram.wrap         = M7_Uniform_Get(shader, "wrap", SHADER_UNIFORM_INT);
+
+    M7_Shader_BindCameraBlock(shader);
+
+    shader = LoadShaderFromMemory(M7_SpriteVertex, M7_SpriteFragment);
+    programs->spriteProgram.shader = shader;
+
+    programs->spriteProgram.locTargetSize = GetShaderLocation(shader, "targetSize");
+    programs->spriteProgram.locTexSize    = GetShaderLocation(shader, "texSize");
+    programs->spriteProgram.locCamPos     = GetShaderLocation(shader, "camPos");
+    programs->spriteProgram.locCamRot     = GetShaderLocation(shader, "camRot");
+    programs->spriteProgram.locZoom       = GetShaderLocation(shader, "zoom");
+    programs->spriteProgram.locFOV        = GetShaderLocation(shader, "fov");
+    programs->spriteProgram.locOffset     = GetShaderLocation(shader, "offset");
+    programs->spriteProgram.locAlphaCutoff = GetShaderLocation(shader, "alphaCutoff");
+
+    shader = LoadShaderFromMemory(0, M7_PickFragment);
+    programs->pickProgram.shader = shader;
+
+    programs->pickProgram.locAlphaCutoff = GetShaderLocation(shader, "alphaCutoff");
+
+    const float pickCutoff = M7_PICK_ALPHA_CUTOFF;
+    SetShaderValue(shader, programs->pickProgram.locAlphaCutoff, &pickCutoff, SHADER_UNIFORM_FLOAT);
+
+    shader = LoadShaderFromMemory(0, M7_AlphaTestFragment);
+    programs->alphaTestProgram.shader = shader;
+
+    programs->alphaTestProgram.locAlphaCutoff = GetShaderLocation(shader, "alphaCutoff");
+
+    const float alphaCutoff = M7_DEPTH_ALPHA_CUTOFF;
+    SetShaderValue(shader, programs->alphaTestProgram.locAlphaCutoff, &alphaCutoff, SHADER_UNIFORM_FLOAT);
+
+    programs->refCount = 1;
+    M7_SharedPrograms = programs;
+
+    return programs;
+}
+
+/**
+ * Release the shaders of the module, unloading them once they are no longer used by any camera.
+ *
+ * @param programs The shared shaders.
+ */
+static void M7_Programs_Release(M7_Programs* programs)
+{
+    if (!programs || --programs->refCount > 0) return;
+
+    UnloadShader(programs->planeProgram.shader);
+    UnloadShader(programs->tilemapProgram.shader);
+    UnloadShader(programs->virtualProgram.shader);
+    UnloadShader(programs->spriteProgram.shader);
+    UnloadShader(programs->alphaTestProgram.shader);
+    UnloadShader(programs->pickProgram.shader);
+
+    if (programs == M7_SharedPrograms) M7_SharedPrograms = NULL;
+
+    free(programs);
+}
+
+/*
+    Shader uniform functions (functions automatically called by the module)
+*/
+
+/**
+ * Get a uniform of a shader whose value is uploaded only when it changes.
+ *
+ * @param shader The shader.
+ * @param name The name of the uniform.
+ * @param type The ShaderUniformDataType of the uniform (float, int or vectors of them).
+ *
+ * @return The uniform, with no value uploaded yet.
+ */
+static M7_Uniform M7_Uniform_Get(Shader shader, const char* name, int type)
+{
+    return (M7_Uniform) { .loc = GetShaderLocation(shader, name), .type = type };
+}
+
+/**
+ * Upload the value of a uniform if it differs from the last one uploaded.
+ *
+ * @param shader The shader of the uniform.
+ * @param uniform The uniform.
+ * @param value The new value, of the type of the uniform.
+ */
+static void M7_Uniform_Set(Shader shader, M7_Uniform* uniform, const void* value)
+{
+    if (uniform->loc < 0) return;
+
+    size_t size = 4;
+
+    switch (uniform->type)
+    {
+        case SHADER_UNIFORM_VEC2: case SHADER_UNIFORM_IVEC2: size = 8; break;
+        case SHADER_UNIFORM_VEC3: case SHADER_UNIFORM_IVEC3: size = 12; break;
+        case SHADER_UNIFORM_VEC4: case SHADER_UNIFORM_IVEC4: size = 16; break;
+        default: break;
+    }
+
+    if (uniform->valid && memcmp(uniform->value, value, size) == 0) return;
+
+    memcpy(uniform->value, value, size);
+    uniform->valid = true;
+
+    SetShaderValue(shader, uniform->loc, value, uniform->type);
+}
+
+/**
+ * Bind the 'M7_CameraBlock' uniform block of a plane shader to the binding point of the camera parameters.
+ *
+ * @param shader The shader.
+ */
+static void M7_Shader_BindCameraBlock(Shader shader)
+{
+    const GLuint index = glGetUniformBlockIndex(shader.id, "M7_CameraBlock");
+
+    if (index != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(shader.id, index, M7_UNIFORM_BINDING);
+    }
+}
+
+/**
+ * Upload the camera parameters of the plane shaders if they have changed, and bind
+ * them for the next plane pass (the binding point is shared by all the cameras).
+ *
+ * @param camera The Mode 7 camera.
+ */
+static void M7_Camera_UseUniforms(M7_Camera* camera)
+{
+    if (camera->uniforms.dirty)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, camera->uniforms.ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(M7_CameraUniforms), &camera->uniforms.data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        camera->uniforms.dirty = false;
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, M7_UNIFORM_BINDING, camera->uniforms.ubo);
+}
+
+/*
+    Plane culling functions (functions automatically called by the module)
+*/
+
+/**
+ * Get the depth of a world point in the camera space, as used by M7_ToScreen().
+ * A point is in front of the camera when its depth is positive, and it is projected
+ * on the render target rows when its depth is greater than or equal to the camera offset.
+ *
+ * @param camera The Mode 7 camera.
+ * @param point The world coordinates of the point.
+ *
+ * @return The depth of the point.
+ */
+static float M7_Camera_GetDepth(M7_Camera* camera, Vector2 point)
+{
+    float objX = -(camera->position.x - point.x) / camera->zoom;
+    float objY = (camera->position.y - point.y) / camera->zoom;
+
+    return 1 - (objX * camera->rotMat.m2 + objY * camera->rotMat.m3) * camera->fov;
+}
+
+/**
+ * Compute the bounds on the render target of a world area drawn as a plane.
+ *
+ * The area is first clipped against the depth corresponding to the bottom row of the target
+ * (everything closer is below the screen or behind the camera), then the remaining corners
+ * are projected with M7_ToScreen() and their bounding box is clamped to the target.
+ *
+ * @param camera The Mode 7 camera.
+ * @param area The world area covered by the plane.
+ * @param bounds Receives the bounds on the render target (in pixels), left untouched if culling is not possible.
+ *
+ * @return False if the area is not visible at all, true otherwise.
+ */
+static bool M7_Camera_GetPlaneBounds(M7_Camera* camera, Rectangle area, Rectangle* bounds)
+{
+    // With these parameters the projection is not a regular
+    // perspective anymore, so the whole target is kept
+
+    if (camera->offset <= 0 || camera->zoom <= 0 || camera->fov <= 0) return true;
+
+    if (area.width < 0) area.x += area.width, area.width = -area.width;
+    if (area.height < 0) area.y += area.height, area.height = -area.height;
+
+    const Vector2 corners[4] = {
+        { area.x, area.y },
+        { area.x + area.width, area.y },
+        { area.x + area.width, area.y + area.height },
+        { area.x, area.y + area.height }
+    };
+
+    float depths[4];
+    for (int i = 0; i < 4; i++)
+    {
+        depths[i] = M7_Camera_GetDepth(camera, corners[i]);
+    }
+
+    // Clip the area against the near depth (a clipped quad has at most 5 vertices)
+
+    const float near = camera->offset * 0.99f;
+
+    Vector2 clipped[5];
+    int count = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        int j = (i + 1) % 4;
+
+        bool inCur = depths[i] >= near;
+        bool inNext = depths[j] >= near;
+
+        if (inCur) clipped[count++] = corners[i];
+
+        if (inCur != inNext)
+        {
+            float t = (near - depths[i]) / (depths[j] - depths[i]);
+
+            clipped[count++] = (Vector2) {
+                corners[i].x + (corners[j].x - corners[i].x) * t,
+                corners[i].y + (corners[j].y - corners[i].y) * t
+            };
+        }
+    }
+
+    if (count == 0) return false;
+
+    // Bounding box of the projected area
+
+    float minX = INFINITY, minY = INFINITY;
+    float maxX = -INFINITY, maxY = -INFINITY;
+
+    for (int i = 0; i < count; i++)
+    {
+        Vector3 p = M7_ToScreen(camera, clipped[i]);
+
+        if (p.x < minX) minX = p.x;
+        if (p.y < minY) minY = p.y;
+        if (p.x > maxX) maxX = p.x;
+        if (p.y > maxY) maxY = p.y;
+    }
+
+    const float width = camera->target.texture.width;
+    const float height = camera->target.texture.height;
+
+    minX = fmaxf(floorf(minX) - 1, 0), minY = fmaxf(floorf(minY) - 1, 0);
+    maxX = fminf(ceilf(maxX) + 1, width), maxY = fminf(ceilf(maxY) + 1, height);
+
+    if (minX >= maxX || minY >= maxY) return false;
+
+    *bounds = (Rectangle) { minX, minY, maxX - minX, maxY - minY };
+
+    return true;
+}
+
+/**
+ * Remove from the bounds of a plane pass the rows that are entirely beyond the far distance.
+ *
+ * These rows are at the top of the target (the horizon being the first row), the plane shaders
+ * would only fill them with the fog color, so they are filled here with a plain rectangle instead,
+ * or left untouched when the fog color is transparent. The row at the boundary is kept in the
+ * pass so that the result is the same as with the shaders alone.
+ *
+ * @param camera The Mode 7 camera.
+ * @param bounds The bounds of the pass on the render target (in pixels), updated to the remaining rows.
+ *
+ * @return False if no row is left to shade, true otherwise.
+ */
+static bool M7_Camera_ClipFarRows(M7_Camera* camera, Rectangle* bounds)
+{
+    if (camera->farDistance <= 0 || camera->offset <= 0 || camera->zoom <= 0 || camera->fov <= 0) return true;
+
+    // Row coordinate of the far distance, of same depth as the one computed by the plane shaders
+
+    const float v = camera->offset / (1.0f + camera->fov * camera->farDistance / camera->zoom);
+    const float farRow = fminf(floorf(v * camera->target.texture.height), bounds->y + bounds->height);
+
+    if (farRow <= bounds->y) return true;
+
+    if (camera->fogColor.a > 0)
+    {
+        DrawRectangleRec((Rectangle) { bounds->x, bounds->y, bounds->width, farRow - bounds->y }, camera->fogColor);
+    }
+
+    bounds->height -= farRow - bounds->y;
+    bounds->y = farRow;
+
+    return (bounds->height > 0);
+}
+
+/**
+ * Draw the quad covering the given bounds of the render target for a plane pass.
+ * The texture coordinates of the quad are those of a full target quad, as expected by the plane shaders.
+ * The quad is drawn with the default raylib texture, the target being the framebuffer it must not be sampled.
+ *
+ * @param camera The Mode 7 camera.
+ * @param bounds The bounds to cover on the render target (in pixels).
+ */
+static void M7_Camera_DrawPlaneQuad(M7_Camera* camera, Rectangle bounds)
+{
+    const float width = camera->target.texture.width;
+    const float height = camera->target.texture.height;
+
+    const float u0 = bounds.x / width, u1 = (bounds.x + bounds.width) / width;
+    const float v0 = bounds.y / height, v1 = (bounds.y + bounds.height) / height;
+
+    rlSetTexture(rlGetTextureIdDefault());
+
+    rlBegin(RL_QUADS);
+
+        rlColor4ub(255, 255, 255, 255);
+
+        rlTexCoord2f(u0, v0);
+        rlVertex2f(bounds.x, bounds.y);
+
+        rlTexCoord2f(u0, v1);
+        rlVertex2f(bounds.x, bounds.y + bounds.height);
+
+        rlTexCoord2f(u1, v1);
+        rlVertex2f(bounds.x + bounds.width, bounds.y + bounds.height);
+
+        rlTexCoord2f(u1, v0);
+        rlVertex2f(bounds.x + bounds.width, bounds.y);
+
+    rlEnd();
+
+    rlSetTexture(0);
+}
+
+/**
+ * Rebuild and upload the row table of the plane shaders.
+ *
+ * The camera space position of a pixel of the plane is linear along a row of the target,
+ * so each texel stores its value at the left edge (xy) and its step per unit of the horizontal
+ * texture coordinate (zw), sampled at the center of the row.
+ *
+ * @param camera The Mode 7 camera.
+ */
+static void M7_Camera_UpdateRowTable(M7_Camera* camera)
+{
+    float *rows = camera->rowTable.rows;
+
+    if (!rows) return;
+
+    // One row per row of the viewport, the remaining texels are not read
+
+    int width, height;
+    M7_Camera_GetViewport(camera, &width, &height);
+
+    for (int i = 0; i < height; i++)
+    {
+        M7_Camera_GetRowTerms(camera, i, height, rows + 4 * i);
+    }
+
+    UpdateTexture(camera->rowTable.texture, rows);
+    camera->rowTable.dirty = false;
+}
+
+/**
+ * Compute the terms of the plane projection on a row of the viewport, with the modulation of its scanline if any.
+ * Same terms as the plane shaders without the row table, 'camRot' being uploaded in column-major order.
+ *
+ * @param camera The Mode 7 camera.
+ * @param row The row of the viewport, from the top.
+ * @param height The height of the viewport (in pixels).
+ * @param terms Receives the camera space position at the left edge of the row (xy)
+ *              and its step per unit of the horizontal texture coordinate (zw).
+ */
+static void M7_Camera_GetRowTerms(const M7_Camera* camera, int row, int height, float* terms)
+{
+    Matrix2x2 rot = camera->rotMat;
+    float zoom = camera->zoom;
+    float offset = camera->offset;
+    Vector2 scroll = { 0 };
+
+    if (camera->rowTable.scanlines)
+    {
+        const M7_Scanline *line = &camera->rowTable.scanlines[(int)((int64_t)row * camera->rowTable.scanlineCount / height)];
+
+        if (line->rotation != 0.0f)
+        {
+            const float cosR = cosf(camera->rotation + line->rotation);
+            const float sinR = sinf(camera->rotation + line->rotation);
+
+            rot = (Matrix2x2) { cosR, -sinR, sinR, cosR };
+        }
+
+        zoom += line->zoom;
+        offset += line->offset;
+        scroll = line->scroll;
+    }
+
+    const float v = (row + 0.5f) / height;
+    const float invV = 1.0f / v;
+
+    const float startX = 0.5f * zoom;
+    const float y = (offset - v) * zoom / camera->fov;
+
+    terms[0] = (startX * rot.m0 + y * rot.m1) * invV + scroll.x;
+    terms[1] = (startX * rot.m2 + y * rot.m3) * invV + scroll.y;
+    terms[2] = -zoom * rot.m0 * invV;
+    terms[3] = -zoom * rot.m2 * invV;
+}
+
+/**
+ * Get the size of the part of the target in which the view is rendered, according to the resolution scale.
+ *
+ * @param camera The Mode 7 camera.
+ * @param width Receives the width of the viewport (in pixels).
+ * @param height Receives the height of the viewport (in pixels).
+ */
+static void M7_Camera_GetViewport(const M7_Camera* camera, int* width, int* height)
+{
+    *width = (int)(camera->target.texture.width * camera->resolutionScale + 0.5f);
+    *height = (int)(camera->target.texture.height * camera->resolutionScale + 0.5f);
+
+    if (*width < 1) *width = 1;
+    if (*height < 1) *height = 1;
+}
+
+/**
+ * Change the resolution scale of the camera and update what depends on the size of the viewport.
+ * Nothing is updated while the size of the viewport stays the same (the scale is zero on load).
+ *
+ * @param camera The Mode 7 camera.
+ * @param scale The new resolution scale (clamped between 1/16 and 1).
+ */
+static void M7_Camera_ApplyResolutionScale(M7_Camera* camera, float scale)
+{
+    const float oldScale = camera->resolutionScale;
+
+    int oldWidth, oldHeight;
+    M7_Camera_GetViewport(camera, &oldWidth, &oldHeight);
+
+    camera->resolutionScale = fminf(fmaxf(scale, 1.0f / 16), 1.0f);
+
+    int width, height;
+    M7_Camera_GetViewport(camera, &width, &height);
+
+    if (oldScale > 0 && width == oldWidth && height == oldHeight) return;
+
+    // The plane shaders take the size of the pixels into account for their LOD
+
+    camera->uniforms.data.targetSize[0] = (float)width;
+    camera->uniforms.data.targetSize[1] = (float)height;
+    camera->uniforms.data.rowCount = (float)height;
+    camera->uniforms.dirty = true;
+
+    if (camera->target.id > 0)
+    {
+        SetTextureFilter(camera->target.texture, (camera->resolutionScale < 1.0f) ? TEXTURE_FILTER_BILINEAR : TEXTURE_FILTER_POINT);
+    }
+
+    camera->rowTable.dirty = true;
+}
+
+/*
+    Batch conversion functions (functions automatically called by the module)
+*/
+
+/**
+ * Compute the camera terms of the coordinate conversions for M7_ToScreenN() and M7_ToWorldN().
+ * M7_ToScreen() is expanded so that the offset of a point to the camera is only multiplied by constant factors.
+ *
+ * @param camera The Mode 7 camera.
+ *
+ * @return The terms of the conversions.
+ */
+static M7_Projection M7_Camera_GetProjection(const M7_Camera* camera)
+{
+    const float width = camera->target.texture.width;
+    const float height = camera->target.texture.height;
+    const float invZoom = 1.0f / camera->zoom;
+
+    return (M7_Projection) {
+        .camX = camera->position.x,
+        .camY = camera->position.y,
+        .spaceXX = -camera->rotMat.m0 * invZoom,
+        .spaceXY = camera->rotMat.m1 * invZoom,
+        .spaceYX = camera->rotMat.m2 * invZoom * camera->fov,
+        .spaceYY = -camera->rotMat.m3 * invZoom * camera->fov,
+        .screenScaleX = camera->offset * width,
+        .screenScaleY = height,
+        .halfWidth = width / 2,
+        .sizeScale = camera->offset * width * invZoom,
+        .offsetMinusOne = camera->offset - 1,
+        .offsetHeight = camera->offset * height,
+        .worldScaleX = camera->zoom / camera->aspect,
+        .worldScaleY = camera->zoom / camera->fov,
+        .rotMat = camera->rotMat
+    };
+}
+
+/**
+ * Convert the world coordinates to screen coordinates by packs of SIMD vectors,
+ * the remaining coordinates are left to the scalar loop of M7_ToScreenN().
+ *
+ * @param proj The terms of the conversion.
+ * @param points The world coordinates to convert.
+ * @param out The screen coordinates.
+ * @param count The number of coordinates to convert.
+ *
+ * @return The number of coordinates converted.
+ */
+static size_t M7_ToScreen_SIMD(const M7_Projection* proj, const Vector2* points, Vector3* out, size_t count)
+{
+    size_t i = 0;
+
+#if defined(M7_SIMD_AVX2)
+
+    const __m256 camX = _mm256_set1_ps(proj->camX), camY = _mm256_set1_ps(proj->camY);
+    const __m256 spaceXX = _mm256_set1_ps(proj->spaceXX), spaceXY = _mm256_set1_ps(proj->spaceXY);
+    const __m256 spaceYX = _mm256_set1_ps(proj->spaceYX), spaceYY = _mm256_set1_ps(proj->spaceYY);
+    const __m256 scaleX = _mm256_set1_ps(proj->screenScaleX), scaleY = _mm256_set1_ps(proj->screenScaleY);
+    const __m256 halfWidth = _mm256_set1_ps(proj->halfWidth), sizeScale = _mm256_set1_ps(proj->sizeScale);
+    const __m256 offsetMinusOne = _mm256_set1_ps(proj->offsetMinusOne), one = _mm256_set1_ps(1.0f);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        // Deinterleave the x and y coordinates of 8 points
+
+        const __m256 a = _mm256_loadu_ps((const float*)(points + i));
+        const __m256 b = _mm256_loadu_ps((const float*)(points + i + 4));
+
+        const __m256 px = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+        const __m256 py = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        const __m256 dx = _mm256_sub_ps(px, camX);
+        const __m256 dy = _mm256_sub_ps(py, camY);
+
+        const __m256 spaceX = _mm256_add_ps(_mm256_mul_ps(dx, spaceXX), _mm256_mul_ps(dy, spaceXY));
+        const __m256 spaceY = _mm256_add_ps(_mm256_mul_ps(dx, spaceYX), _mm256_mul_ps(dy, spaceYY));
+
+        const __m256 invDistance = _mm256_div_ps(one, _mm256_sub_ps(one, spaceY));
+
+        float x[8], y[8], z[8];
+
+        _mm256_storeu_ps(x, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(spaceX, invDistance), scaleX), halfWidth));
+        _mm256_storeu_ps(y, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(spaceY, offsetMinusOne), invDistance), scaleY), scaleY));
+        _mm256_storeu_ps(z, _mm256_mul_ps(sizeScale, invDistance));
+
+        for (int j = 0; j < 8; j++) out[i + j] = (Vector3) { x[j], y[j], z[j] };
+    }
+
+#elif defined(M7_SIMD_SSE2)
+
+    const __m128 camX = _mm_set1_ps(proj->camX), camY = _mm_set1_ps(proj->camY);
+    const __m128 spaceXX = _mm_set1_ps(proj->spaceXX), spaceXY = _mm_set1_ps(proj->spaceXY);
+    const __m128 spaceYX = _mm_set1_ps(proj->spaceYX), spaceYY = _mm_set1_ps(proj->spaceYY);
+    const __m128 scaleX = _mm_set1_ps(proj->screenScaleX), scaleY = _mm_set1_ps(proj->screenScaleY);
+    const __m128 halfWidth = _mm_set1_ps(proj->halfWidth), sizeScale = _mm_set1_ps(proj->sizeScale);
+    const __m128 offsetMinusOne = _mm_set1_ps(proj->offsetMinusOne), one = _mm_set1_ps(1.0f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // Deinterleave the x and y coordinates of 4 points
+
+        const __m128 a = _mm_loadu_ps((const float*)(points + i));
+        const __m128 b = _mm_loadu_ps((const float*)(points + i + 2));
+
+        const __m128 px = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 py = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+        const __m128 dx = _mm_sub_ps(px, camX);
+        const __m128 dy = _mm_sub_ps(py, camY);
+
+        const __m128 spaceX = _mm_add_ps(_mm_mul_ps(dx, spaceXX), _mm_mul_ps(dy, spaceXY));
+        const __m128 spaceY = _mm_add_ps(_mm_mul_ps(dx, spaceYX), _mm_mul_ps(dy, spaceYY));
+
+        const __m128 invDistance = _mm_div_ps(one, _mm_sub_ps(one, spaceY));
+
+        float x[4], y[4], z[4];
+
+        _mm_storeu_ps(x, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(spaceX, invDistance), scaleX), halfWidth));
+        _mm_storeu_ps(y, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(spaceY, offsetMinusOne), invDistance), scaleY), scaleY));
+        _mm_storeu_ps(z, _mm_mul_ps(sizeScale, invDistance));
+
+        for (int j = 0; j < 4; j++) out[i + j] = (Vector3) { x[j], y[j], z[j] };
+    }
+
+#elif defined(M7_SIMD_NEON)
+
+    const float32x4_t camX = vdupq_n_f32(proj->camX), camY = vdupq_n_f32(proj->camY);
+    const float32x4_t scaleX = vdupq_n_f32(proj->screenScaleX), scaleY = vdupq_n_f32(proj->screenScaleY);
+    const float32x4_t halfWidth = vdupq_n_f32(proj->halfWidth), sizeScale = vdupq_n_f32(proj->sizeScale);
+    const float32x4_t offsetMinusOne = vdupq_n_f32(proj->offsetMinusOne), one = vdupq_n_f32(1.0f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // The loads and stores of NEON deinterleave and interleave the components
+
+        const float32x4x2_t p = vld2q_f32((const float*)(points + i));
+
+        const float32x4_t dx = vsubq_f32(p.val[0], camX);
+        const float32x4_t dy = vsubq_f32(p.val[1], camY);
+
+        const float32x4_t spaceX = vmlaq_n_f32(vmulq_n_f32(dx, proj->spaceXX), dy, proj->spaceXY);
+        const float32x4_t spaceY = vmlaq_n_f32(vmulq_n_f32(dx, proj->spaceYX), dy, proj->spaceYY);
+
+        const float32x4_t invDistance = vdivq_f32(one, vsubq_f32(one, spaceY));
+
+        float32x4x3_t r;
+        r.val[0] = vaddq_f32(vmulq_f32(vmulq_f32(spaceX, invDistance), scaleX), halfWidth);
+        r.val[1] = vaddq_f32(vmulq_f32(vmulq_f32(vaddq_f32(spaceY, offsetMinusOne), invDistance), scaleY), scaleY);
+        r.val[2] = vmulq_f32(sizeScale, invDistance);
+
+        vst3q_f32((float*)(out + i), r);
+    }
+
+#else
+
+    (void)proj, (void)points, (void)out, (void)count;
+
+#endif
+
+    return i;
+}
+
+/**
+ * Convert the screen coordinates to world coordinates by packs of SIMD vectors,
+ * the remaining coordinates are left to the scalar loop of M7_ToWorldN().
+ *
+ * @param proj The terms of the conversion.
+ * @param points The screen coordinates to convert.
+ * @param out The world coordinates.
+ * @param count The number of coordinates to convert.
+ *
+ * @return The number of coordinates converted.
+ */
+static size_t M7_ToWorld_SIMD(const M7_Projection* proj, const Vector2* points, Vector2* out, size_t count)
+{
+    size_t i = 0;
+
+#if defined(M7_SIMD_AVX2)
+
+    const __m256 camX = _mm256_set1_ps(proj->camX), camY = _mm256_set1_ps(proj->camY);
+    const __m256 halfWidth = _mm256_set1_ps(proj->halfWidth), offsetHeight = _mm256_set1_ps(proj->offsetHeight);
+    const __m256 scaleX = _mm256_set1_ps(proj->worldScaleX), scaleY = _mm256_set1_ps(proj->worldScaleY);
+    const __m256 m0 = _mm256_set1_ps(proj->rotMat.m0), m1 = _mm256_set1_ps(proj->rotMat.m1);
+    const __m256 m2 = _mm256_set1_ps(proj->rotMat.m2), m3 = _mm256_set1_ps(proj->rotMat.m3);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 a = _mm256_loadu_ps((const float*)(points + i));
+        const __m256 b = _mm256_loadu_ps((const float*)(points + i + 4));
+
+        const __m256 px = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+        const __m256 py = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        const __m256 sx = _mm256_mul_ps(_mm256_sub_ps(halfWidth, px), scaleX);
+        const __m256 sy = _mm256_mul_ps(_mm256_sub_ps(offsetHeight, py), scaleY);
+
+        const __m256 invY = _mm256_div_ps(one, py);
+
+        const __m256 wx = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sx, m0), _mm256_mul_ps(sy, m1)), invY), camX);
+        const __m256 wy = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sx, m2), _mm256_mul_ps(sy, m3)), invY), camY);
+
+        // Interleave back, the unpacks work within 128-bit lanes so the lanes are reordered
+
+        const __m256 lo = _mm256_unpacklo_ps(wx, wy);
+        const __m256 hi = _mm256_unpackhi_ps(wx, wy);
+
+        _mm256_storeu_ps((float*)(out + i), _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps((float*)(out + i + 4), _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+
+#elif defined(M7_SIMD_SSE2)
+
+    const __m128 camX = _mm_set1_ps(proj->camX), camY = _mm_set1_ps(proj->camY);
+    const __m128 halfWidth = _mm_set1_ps(proj->halfWidth), offsetHeight = _mm_set1_ps(proj->offsetHeight);
+    const __m128 scaleX = _mm_set1_ps(proj->worldScaleX), scaleY = _mm_set1_ps(proj->worldScaleY);
+    const __m128 m0 = _mm_set1_ps(proj->rotMat.m0), m1 = _mm_set1_ps(proj->rotMat.m1);
+    const __m128 m2 = _mm_set1_ps(proj->rotMat.m2), m3 = _mm_set1_ps(proj->rotMat.m3);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 a = _mm_loadu_ps((const float*)(points + i));
+        const __m128 b = _mm_loadu_ps((const float*)(points + i + 2));
+
+        const __m128 px = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 py = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+        const __m128 sx = _mm_mul_ps(_mm_sub_ps(halfWidth, px), scaleX);
+        const __m128 sy = _mm_mul_ps(_mm_sub_ps(offsetHeight, py), scaleY);
+
+        const __m128 invY = _mm_div_ps(one, py);
+
+        const __m128 wx = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(sx, m0), _mm_mul_ps(sy, m1)), invY), camX);
+        const __m128 wy = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(sx, m2), _mm_mul_ps(sy, m3)), invY), camY);
+
+        _mm_storeu_ps((float*)(out + i), _mm_unpacklo_ps(wx, wy));
+        _mm_storeu_ps((float*)(out + i + 2), _mm_unpackhi_ps(wx, wy));
+    }
+
+#elif defined(M7_SIMD_NEON)
+
+    const float32x4_t camX = vdupq_n_f32(proj->camX), camY = vdupq_n_f32(proj->camY);
+    const float32x4_t halfWidth = vdupq_n_f32(proj->halfWidth), offsetHeight = vdupq_n_f32(proj->offsetHeight);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const float32x4x2_t p = vld2q_f32((const float*)(points + i));
+
+        const float32x4_t sx = vmulq_n_f32(vsubq_f32(halfWidth, p.val[0]), proj->worldScaleX);
+        const float32x4_t sy = vmulq_n_f32(vsubq_f32(offsetHeight, p.val[1]), proj->worldScaleY);
+
+        const float32x4_t invY = vdivq_f32(one, p.val[1]);
+
+        float32x4x2_t r;
+        r.val[0] = vmlaq_f32(camX, vmlaq_n_f32(vmulq_n_f32(sx, proj->rotMat.m0), sy, proj->rotMat.m1), invY);
+        r.val[1] = vmlaq_f32(camY, vmlaq_n_f32(vmulq_n_f32(sx, proj->rotMat.m2), sy, proj->rotMat.m3), invY);
+
+        vst2q_f32((float*)(out + i), r);
+    }
+
+#else
+
+    (void)proj, (void)points, (void)out, (void)count;
+
+#endif
+
+    return i;
+}
+
+/*
+    Spatial index functions (functions automatically called by the module)
+*/
+
+/**
+ * Get the area of the ground under the view of the Mode 7 camera, up to its far distance.
+ * In camera space, with 's' the lateral coordinate and 'd' the depth of M7_ToScreen(), a point is on the screen
+ * if 'd >= offset' and '|s| <= d / (2 * offset)', which gives a trapezoid once limited by the far distance.
+ * The trapezoid is extended so that it also contains the ground position of the elements that stand outside
+ * of the screen but reach into it, according to their largest extents.
+ *
+ * @param camera The Mode 7 camera.
+ * @param extentX The largest half width of the elements (in world units).
+ * @param extentY The largest height of the elements (in world units).
+ * @param corners The corners of the trapezoid in world space (near left, near right, far right, far left).
+ *
+ * @return True if the area is bounded, false if the camera has no far distance or no visible ground.
+ */
+static bool M7_Camera_GetViewTrapezoid(const M7_Camera* camera, float extentX, float extentY, Vector2 corners[4])
+{
+    if (!(camera->farDistance > 0) || !(camera->offset > 0)) return false;
+
+    const float width = camera->target.texture.width;
+    const float height = camera->target.texture.height;
+
+    // An element of height 'h' at the depth 'd' reaches the bottom of the screen when 'd > offset * (1 - h * width / (zoom * height))'
+
+    const float nearDepth = fmaxf(camera->offset * (1 - extentY * width / (camera->zoom * height)), camera->offset * 1e-3f);
+    const float farDepth = fmaxf(1 + camera->fov * camera->farDistance / camera->zoom, nearDepth);
+
+    const float margin = extentX / camera->zoom;
+
+    const float cs[4][2] = {
+        { -(nearDepth / (2 * camera->offset) + margin), nearDepth },
+        {  (nearDepth / (2 * camera->offset) + margin), nearDepth },
+        {  (farDepth / (2 * camera->offset) + margin), farDepth },
+        { -(farDepth / (2 * camera->offset) + margin), farDepth }
+    };
+
+    // Inverse of the rotation of M7_ToScreen(): s = -x * m0 - y * m1 and (1 - d) / fov = x * m2 + y * m3
+
+    const Matrix2x2 m = camera->rotMat;
+    const float det = m.m1 * m.m2 - m.m0 * m.m3;
+
+    for (int i = 0; i < 4; i++)
+    {
+        const float s = cs[i][0], e = (1 - cs[i][1]) / camera->fov;
+
+        const float objX = (m.m3 * s + m.m1 * e) / det;
+        const float objY = -(m.m2 * s + m.m0 * e) / det;
+
+        corners[i] = (Vector2) {
+            camera->position.x + objX * camera->zoom,
+            camera->position.y - objY * camera->zoom
+        };
+    }
+
+    return true;
+}
+
+/**
+ * Get the horizontal span of a convex polygon within a horizontal band.
+ * Used to rasterize the view trapezoid row by row on a grid.
+ *
+ * @param points The vertices of the polygon, in order.
+ * @param count The number of vertices.
+ * @param y0 The top of the band.
+ * @param y1 The bottom of the band.
+ * @param x0 The left of the span.
+ * @param x1 The right of the span.
+ *
+ * @return True if the polygon crosses the band.
+ */
+static bool M7_Polygon_GetRowSpan(const Vector2* points, int count, float y0, float y1, float* x0, float* x1)
+{
+    bool found = false;
+
+    for (int i = 0; i < count; i++)
+    {
+        const Vector2 a = points[i], b = points[(i + 1) % count];
+
+        // Part of the edge within the band
+
+        const float lo = fmaxf(fminf(a.y, b.y), y0);
+        const float hi = fminf(fmaxf(a.y, b.y), y1);
+        if (lo > hi) continue;
+
+        float xa = a.x, xb = b.x;
+
+        if (a.y != b.y)
+        {
+            xa = a.x + (lo - a.y) / (b.y - a.y) * (b.x - a.x);
+            xb = a.x + (hi - a.y) / (b.y - a.y) * (b.x - a.x);
+        }
+
+        if (!found) *x0 = *x1 = xa, found = true;
+
+        *x0 = fminf(*x0, fminf(xa, xb));
+        *x1 = fmaxf(*x1, fmaxf(xa, xb));
+    }
+
+    return found;
+}
+
+/**
+ * Get the bucket of a cell of the spatial hash grid.
+ *
+ * @param x The horizontal coordinate of the cell.
+ * @param y The vertical coordinate of the cell.
+ *
+ * @return The index of the bucket.
+ */
+static uint32_t M7_SpatialIndex_GetBucket(int32_t x, int32_t y)
+{
+    return (((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u)) & (M7_SPATIAL_BUCKET_COUNT - 1);
+}
+
+/**
+ * Load a spatial hash grid for the elements of a Z-Buffer.
+ *
+ * @param cellSize The size of a cell (in world units).
+ * @param capacity The number of slots of the Z-Buffer.
+ *
+ * @return The spatial index, or NULL if an allocation failed.
+ */
+static M7_SpatialIndex* M7_SpatialIndex_Load(float cellSize, uint32_t capacity)
+{
+    M7_SpatialIndex *grid = (M7_SpatialIndex*)calloc(1, sizeof(M7_SpatialIndex));
+    if (!grid) return NULL;
+
+    grid->cellSize = cellSize;
+    grid->buckets = (uint32_t*)malloc(M7_SPATIAL_BUCKET_COUNT * sizeof(uint32_t));
+
+    if (!grid->buckets || !M7_SpatialIndex_Grow(grid, capacity))
+    {
+        M7_SpatialIndex_Unload(grid);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < M7_SPATIAL_BUCKET_COUNT; i++)
+    {
+        grid->buckets[i] = UINT32_MAX;
+    }
+
+    return grid;
+}
+
+/**
+ * Unload a spatial hash grid, freeing associated resources.
+ *
+ * @param grid The spatial index to unload.
+ */
+static void M7_SpatialIndex_Unload(M7_SpatialIndex* grid)
+{
+    free(grid->buckets);
+    free(grid->next);
+    free(grid->prev);
+    free(grid->cellX);
+    free(grid->cellY);
+    free(grid->stamps);
+    free(grid->moved);
+    free(grid->queued);
+    free(grid->candidates);
+    free(grid);
+}
+
+/**
+ * Grow the arrays of a spatial hash grid to the number of slots of its Z-Buffer.
+ *
+ * @param grid The spatial index to grow.
+ * @param capacity The new number of slots.
+ *
+ * @return True if the arrays have grown, false if an allocation failed.
+ */
+static bool M7_SpatialIndex_Grow(M7_SpatialIndex* grid, uint32_t capacity)
+{
+    if (capacity <= grid->capacity) return true;
+
+    uint32_t *next = (uint32_t*)realloc(grid->next, capacity * sizeof(uint32_t));
+    if (next) grid->next = next;
+
+    uint32_t *prev = (uint32_t*)realloc(grid->prev, capacity * sizeof(uint32_t));
+    if (prev) grid->prev = prev;
+
+    int32_t *cellX = (int32_t*)realloc(grid->cellX, capacity * sizeof(int32_t));
+    if (cellX) grid->cellX = cellX;
+
+    int32_t *cellY = (int32_t*)realloc(grid->cellY, capacity * sizeof(int32_t));
+    if (cellY) grid->cellY = cellY;
+
+    uint32_t *stamps = (uint32_t*)realloc(grid->stamps, capacity * sizeof(uint32_t));
+    if (stamps) grid->stamps = stamps;
+
+    uint32_t *moved = (uint32_t*)realloc(grid->moved, capacity * sizeof(uint32_t));
+    if (moved) grid->moved = moved;
+
+    bool *queued = (bool*)realloc(grid->queued, capacity * sizeof(bool));
+    if (queued) grid->queued = queued;
+
+    uint32_t *candidates = (uint32_t*)realloc(grid->candidates, capacity * sizeof(uint32_t));
+    if (candidates) grid->candidates = candidates;
+
+    if (!next || !prev || !cellX || !cellY || !stamps || !moved || !queued || !candidates)
+    {
+        return false;
+    }
+
+    for (uint32_t i = grid->capacity; i < capacity; i++)
+    {
+        grid->next[i] = grid->prev[i] = UINT32_MAX;
+        grid->stamps[i] = grid->frame;
+        grid->queued[i] = false;
+    }
+
+    grid->capacity = capacity;
+
+    return true;
+}
+
+/**
+ * Insert an element in the cell of its position in a spatial hash grid, and extend the largest extents of the grid.
+ *
+ * @param grid The spatial index.
+ * @param elem The element to insert.
+ */
+static void M7_SpatialIndex_Insert(M7_SpatialIndex* grid, const M7_ZBuffer_Element* elem)
+{
+    const uint32_t slot = elem->slot;
+
+    const int32_t x = (int32_t)floorf(elem->onWorld.position.x / grid->cellSize);
+    const int32_t y = (int32_t)floorf(elem->onWorld.position.y / grid->cellSize);
+    const uint32_t bucket = M7_SpatialIndex_GetBucket(x, y);
+
+    grid->cellX[slot] = x;
+    grid->cellY[slot] = y;
+
+    grid->prev[slot] = UINT32_MAX;
+    grid->next[slot] = grid->buckets[bucket];
+
+    if (grid->buckets[bucket] != UINT32_MAX) grid->prev[grid->buckets[bucket]] = slot;
+    grid->buckets[bucket] = slot;
+
+    // Same extents as the screen rectangle of M7_ZBuffer_Element_Update() and the circle of M7_ZBuffer_Element_Draw()
+
+    const Vector2 scale = elem->onWorld.scale;
+
+    if (elem->type == M7_ZBT_CIRCLE)
+    {
+        grid->extentX = fmaxf(grid->extentX, fabsf(scale.x));
+        grid->extentY = fmaxf(grid->extentY, 2 * fabsf(scale.x));
+    }
+    else
+    {
+        grid->extentX = fmaxf(grid->extentX, 0.5f * fabsf(scale.x));
+        grid->extentY = fmaxf(grid->extentY, fabsf(scale.y * elem->onWorld.rectangle.width / elem->onWorld.rectangle.height));
+    }
+}
+
+/**
+ * Remove a slot from its cell in a spatial hash grid.
+ *
+ * @param grid The spatial index.
+ * @param slot The slot of the element to remove.
+ */
+static void M7_SpatialIndex_Remove(M7_SpatialIndex* grid, uint32_t slot)
+{
+    const uint32_t next = grid->next[slot], prev = grid->prev[slot];
+
+    if (prev != UINT32_MAX) grid->next[prev] = next;
+    else grid->buckets[M7_SpatialIndex_GetBucket(grid->cellX[slot], grid->cellY[slot])] = next;
+
+    if (next != UINT32_MAX) grid->prev[next] = prev;
+
+    grid->next[slot] = grid->prev[slot] = UINT32_MAX;
+}
+
+/**
+ * Move the elements modified since the last frame to the cells of their new position.
+ *
+ * @param grid The spatial index.
+ * @param buffer The Mode 7 Z-Buffer of the elements.
+ */
+static void M7_SpatialIndex_Update(M7_SpatialIndex* grid, M7_ZBuffer* buffer)
+{
+    for (uint32_t i = 0; i < grid->movedCount; i++)
+    {
+        const uint32_t slot = grid->moved[i];
+        const M7_ZBuffer_Element *elem = M7_ZBuffer_Element_Get(buffer, slot);
+
+        grid->queued[slot] = false;
+        if (!elem->alive) continue;
+
+        M7_SpatialIndex_Remove(grid, slot);
+        M7_SpatialIndex_Insert(grid, elem);
+    }
+
+    grid->movedCount = 0;
+}
+
+/**
+ * Gather the elements of the cells covered by the view trapezoid of the camera into the candidates of the grid.
+ * The elements returned are stamped with the frame of the query.
+ *
+ * @param grid The spatial index.
+ * @param buffer The Mode 7 Z-Buffer of the elements.
+ * @param camera The Mode 7 camera.
+ *
+ * @return True if the query has been done, false if the view is not bounded or covers more cells than there are elements.
+ */
+static bool M7_SpatialIndex_Query(M7_SpatialIndex* grid, M7_ZBuffer* buffer, const M7_Camera* camera)
+{
+    Vector2 corners[4];
+
+    if (!M7_Camera_GetViewTrapezoid(camera, grid->extentX, grid->extentY, corners))
+    {
+        return false;
+    }
+
+    float minX = corners[0].x, maxX = corners[0].x;
+    float minY = corners[0].y, maxY = corners[0].y;
+
+    for (int i = 1; i < 4; i++)
+    {
+        minX = fminf(minX, corners[i].x), maxX = fmaxf(maxX, corners[i].x);
+        minY = fminf(minY, corners[i].y), maxY = fmaxf(maxY, corners[i].y);
+    }
+
+    const float cellSize = grid->cellSize;
+
+    if (((double)(maxX - minX) / cellSize + 1) * ((double)(maxY - minY) / cellSize + 1) > (double)buffer->count)
+    {
+        return false;
+    }
+
+    const int32_t row0 = (int32_t)floorf(minY / cellSize);
+    const int32_t row1 = (int32_t)floorf(maxY / cellSize);
+
+    grid->frame++;
+    grid->candidateCount = 0;
+
+    for (int32_t y = row0; y <= row1; y++)
+    {
+        float x0, x1;
+
+        if (!M7_Polygon_GetRowSpan(corners, 4, y * cellSize, (y + 1) * cellSize, &x0, &x1))
+        {
+            continue;
+        }
+
+        const int32_t col0 = (int32_t)floorf(x0 / cellSize);
+        const int32_t col1 = (int32_t)floorf(x1 / cellSize);
+
+        for (int32_t x = col0; x <= col1; x++)
+        {
+            // The buckets are shared by several cells, the elements of the other cells are skipped
+
+            for (uint32_t slot = grid->buckets[M7_SpatialIndex_GetBucket(x, y)]; slot != UINT32_MAX; slot = grid->next[slot])
+            {
+                if (grid->cellX[slot] != x || grid->cellY[slot] != y) continue;
+
+                grid->stamps[slot] = grid->frame;
+                grid->candidates[grid->candidateCount++] = M7_ZBuffer_Element_Get(buffer, slot)->index;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*
+    Virtual texture functions (functions automatically called by the module)
+*/
+
+/**
+ * Compare two missing pages of a virtual texture by their depth (used with qsort).
+ *
+ * @param a The first page.
+ * @param b The second page.
+ *
+ * @return A negative value if the first page is nearer, a positive one if it is farther, zero otherwise.
+ */
+static int M7_VirtualTexture_Compare(const void* a, const void* b)
+{
+    const float da = ((const M7_PageCandidate*)a)->depth;
+    const float db = ((const M7_PageCandidate*)b)->depth;
+
+    return (da > db) - (da < db);
+}
+
+/**
+ * Gather the pages of a virtual texture under the view of the camera.
+ * The resident pages are marked as used on this draw, and the missing ones are requested, the nearest first,
+ * up to the maximum number of requests of the texture. The view trapezoid is rasterized on the grid of the
+ * pages, it is replaced by the whole map when the camera has no far distance.
+ *
+ * @param texture The virtual texture.
+ * @param camera The Mode 7 camera.
+ * @param position The world position of the top left corner of the map.
+ * @param scale The scale of the map.
+ * @param wrap The wrap mode for the map.
+ */
+static void M7_VirtualTexture_Feedback(M7_VirtualTexture* texture, M7_Camera* camera, Vector2 position, Vector2 scale, int wrap)
+{
+    texture->frame++;
+
+    const float pageWidth = texture->pageSize * scale.x;
+    const float pageHeight = texture->pageSize * scale.y;
+
+    if (!(pageWidth > 0) || !(pageHeight > 0)) return;
+
+    Vector2 corners[4];
+
+    if (M7_Camera_GetViewTrapezoid(camera, 0, 0, corners))
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            corners[i].x = (corners[i].x - position.x) / pageWidth;
+            corners[i].y = (corners[i].y - position.y) / pageHeight;
+        }
+    }
+    else
+    {
+        corners[0] = (Vector2) { 0, 0 };
+        corners[1] = (Vector2) { (float)texture->pagesX, 0 };
+        corners[2] = (Vector2) { (float)texture->pagesX, (float)texture->pagesY };
+        corners[3] = (Vector2) { 0, (float)texture->pagesY };
+    }
+
+    float minY = corners[0].y, maxY = corners[0].y;
+
+    for (int i = 1; i < 4; i++)
+    {
+        minY = fminf(minY, corners[i].y), maxY = fmaxf(maxY, corners[i].y);
+    }
+
+    int32_t row0 = (int32_t)floorf(minY);
+    int32_t row1 = (int32_t)floorf(maxY);
+
+    if (!wrap)
+    {
+        row0 = (row0 < 0) ? 0 : row0;
+        row1 = (row1 >= texture->pagesY) ? texture->pagesY - 1 : row1;
+    }
+
+    // With the wrap mode, a view covering more rows than the map walks each row of pages once,
+    // over all its columns since the rows it is repeated on can cover different columns
+
+    const bool allRows = wrap && (row1 - row0 >= texture->pagesY);
+    if (allRows) row1 = row0 + texture->pagesY - 1;
+
+    uint32_t missing = 0;
+
+    for (int32_t y = row0; y <= row1; y++)
+    {
+        float x0 = 0.0f, x1 = (float)(texture->pagesX - 1);
+
+        if (!allRows && !M7_Polygon_GetRowSpan(corners, 4, (float)y, (float)(y + 1), &x0, &x1))
+        {
+            continue;
+        }
+
+        int32_t col0 = (int32_t)floorf(x0);
+        int32_t col1 = (int32_t)floorf(x1);
+
+        if (!wrap)
+        {
+            col0 = (col0 < 0) ? 0 : col0;
+            col1 = (col1 >= texture->pagesX) ? texture->pagesX - 1 : col1;
+        }
+        else if (col1 - col0 >= texture->pagesX)
+        {
+            col1 = col0 + texture->pagesX - 1;
+        }
+
+        const int32_t pageY = wrap ? ((y % texture->pagesY) + texture->pagesY) % texture->pagesY : y;
+
+        for (int32_t x = col0; x <= col1; x++)
+        {
+            const int32_t pageX = wrap ? ((x % texture->pagesX) + texture->pagesX) % texture->pagesX : x;
+            const uint32_t page = (uint32_t)pageY * texture->pagesX + pageX;
+
+            switch (texture->states[page])
+            {
+                case M7_PAGE_RESIDENT:
+                {
+                    const uint8_t *entry = texture->table + 4 * page;
+                    texture->slotStamps[entry[1] * texture->cacheColumns + entry[0]] = texture->frame;
+                    break;
+                }
+
+                case M7_PAGE_MISSING:
+                {
+                    // The pages behind the camera, only gathered without far distance, come last
+
+                    float depth = M7_Camera_GetDepth(camera, (Vector2) {
+                        position.x + (x + 0.5f) * pageWidth,
+                        position.y + (y + 0.5f) * pageHeight
+                    });
+
+                    texture->candidates[missing++] = (M7_PageCandidate) { (depth < 0) ? INFINITY : depth, page };
+                    texture->states[page] = M7_PAGE_QUEUED;
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    // The states are updated before calling the callback, which can submit the pages right away
+
+    uint32_t count = texture->request ? missing : 0;
+
+    if (count > texture->maxRequests)
+    {
+        qsort(texture->candidates, missing, sizeof(M7_PageCandidate), M7_VirtualTexture_Compare);
+        count = texture->maxRequests;
+    }
+
+    for (uint32_t i = 0; i < missing; i++)
+    {
+        texture->states[texture->candidates[i].page] = (i < count) ? M7_PAGE_REQUESTED : M7_PAGE_MISSING;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t page = texture->candidates[i].page;
+        texture->request((int)(page % texture->pagesX), (int)(page / texture->pagesX), texture->userData);
+    }
+}
+
+/*
+    Asset loader functions (functions automatically called by the module)
+*/
+
+/**
+ * Upload the next rows of a decoded asset, creating its texture on the first call.
+ * The rows are copied into the orphaned storage of the pixel unpack buffer, so the copy to the texture
+ * is performed by the driver without stalling on the previous uploads.
+ *
+ * @param loader The asset loader of the asset.
+ * @param asset The asset to upload (decoded or uploading).
+ * @param budget The number of bytes that can be uploaded (at least one row is uploaded).
+ *
+ * @return The number of bytes uploaded.
+ */
+static size_t M7_Loader_Upload(M7_Loader* loader, M7_Asset* asset, size_t budget)
+{
+    const int width = asset->image.width;
+    const int height = asset->image.height;
+    const size_t pitch = 4 * (size_t)width;
+
+    if (asset->state == M7_ASSET_DECODED)
+    {
+        asset->uploaded = (Texture2D) {
+            .id = rlLoadTexture(NULL, width, height, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1),
+            .width = width, .height = height, .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+        };
+
+        if (asset->uploaded.id == 0)
+        {
+            UnloadImage(asset->image);
+            asset->image = (Image) { 0 };
+            asset->state = M7_ASSET_FAILED;
+            return 0;
+        }
+
+        asset->uploadedRows = 0;
+        asset->state = M7_ASSET_UPLOADING;
+    }
+
+    int rows = (int)(budget / pitch);
+    if (rows < 1) rows = 1;
+    if (rows > height - asset->uploadedRows) rows = height - asset->uploadedRows;
+
+    const size_t size = (size_t)rows * pitch;
+    const unsigned char *pixels = (const unsigned char*)asset->image.data + (size_t)asset->uploadedRows * pitch;
+
+    glBindTexture(GL_TEXTURE_2D, asset->uploaded.id);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, loader->pbo);
+
+    if (loader->pbo)
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_DRAW);
+        void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+        if (mapped)
+        {
+            memcpy(mapped, pixels, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            pixels = NULL;  // Offset in the pixel unpack buffer
+        }
+        else
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, asset->uploadedRows, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    asset->uploadedRows += rows;
+
+    if (asset->uploadedRows >= height)
+    {
+        if (asset->mipmaps) GenTextureMipmaps(&asset->uploaded);
+
+        UnloadImage(asset->image);
+        asset->image = (Image) { 0 };
+
+        asset->texture = asset->uploaded;
+        asset->state = M7_ASSET_READY;
+    }
+
+    return size;
+}
+
+/*
+    Software rendering functions (functions automatically called by the module)
+*/
+
+/**
+ * Blend a color over a pixel of the software backend, as the default blend mode of raylib.
+ *
+ * @param dst The pixel to blend over (RGBA8).
+ * @param src The color to blend.
+ */
+static void M7_Software_Blend(unsigned char* dst, Color src)
+{
+    if (src.a == 0) return;
+
+    if (src.a == 255)
+    {
+        dst[0] = src.r, dst[1] = src.g, dst[2] = src.b, dst[3] = 255;
+        return;
+    }
+
+    const int a = src.a, ia = 255 - a;
+
+    dst[0] = (unsigned char)((src.r * a + dst[0] * ia + 127) / 255);
+    dst[1] = (unsigned char)((src.g * a + dst[1] * ia + 127) / 255);
+    dst[2] = (unsigned char)((src.b * a + dst[2] * ia + 127) / 255);
+    dst[3] = (unsigned char)((src.a * a + dst[3] * ia + 127) / 255);
+}
+
+/**
+ * Blend a texel of a plane over a pixel of the software backend, after mixing it with the fog color.
+ *
+ * @param dst The RGBA8 pixel.
+ * @param texel The RGBA8 texel.
+ * @param fog The fog factor of the row (0 to 255).
+ * @param fogColor The fog color.
+ */
+static void M7_Software_Shade(unsigned char* dst, const unsigned char* texel, int fog, Color fogColor)
+{
+    Color color = { texel[0], texel[1], texel[2], texel[3] };
+
+    if (fog > 0)
+    {
+        color.r = (unsigned char)(color.r + ((fogColor.r - color.r) * fog) / 255);
+        color.g = (unsigned char)(color.g + ((fogColor.g - color.g) * fog) / 255);
+        color.b = (unsigned char)(color.b + ((fogColor.b - color.b) * fog) / 255);
+        color.a = (unsigned char)(color.a + ((fogColor.a - color.a) * fog) / 255);
+    }
+
+    M7_Software_Blend(dst, color);
+}
+
+/**
+ * Clear the image of a camera of the software backend.
+ *
+ * @param camera The Mode 7 camera.
+ * @param color The clear color.
+ */
+static void M7_Software_Clear(M7_Camera* camera, Color color)
+{
+    unsigned char *pixels = (unsigned char*)camera->software.image.data;
+
+    if (!pixels) return;
+
+    const size_t count = (size_t)camera->software.image.width * camera->software.image.height;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(pixels + 4 * i, &color, 4);
+    }
+}
+
+/**
+ * Shade the rows of a plane pass of the software backend (M7_Job).
+ *
+ * The camera space position is linear along a row, as in the row table of the plane shaders
+ * (see M7_Camera_UpdateRowTable()), so it is converted once per row to texel coordinates
+ * and only a multiply-add is left per pixel. With AVX2, the texel addresses of eight pixels
+ * are computed at once and their texels fetched with a single gather.
+ *
+ * @param data The pass (M7_SoftwareData).
+ * @param first The first batch of M7_SOFTWARE_BATCH_ROWS rows.
+ * @param count The number of batches.
+ */
+static void M7_Software_PlaneJob(void* data, uint32_t first, uint32_t count)
+{
+    const M7_SoftwareData *pass = (const M7_SoftwareData*)data;
+    const M7_Camera *camera = pass->camera;
+    const Image *map = pass->map;
+
+    const int rowBegin = pass->y0 + (int)(first * M7_SOFTWARE_BATCH_ROWS);
+    const int rowEnd = (int)fminf((float)pass->y0 + (first + count) * M7_SOFTWARE_BATCH_ROWS, (float)pass->y1);
+
+    unsigned char *pixels = (unsigned char*)camera->software.image.data;
+    const unsigned char *texels = (const unsigned char*)map->data;
+    const int stride = camera->software.image.width;
+
+    const float scaleY = camera->zoom / camera->fov;
+
+    const float texelsX = map->width / pass->mapSize[0];
+    const float texelsY = map->height / pass->mapSize[1];
+
+    const float fogStart = camera->uniforms.data.fogRange[0];
+    const float fogEnd = camera->uniforms.data.fogRange[1];
+    const Color fogColor = camera->fogColor;
+
+    for (int y = rowBegin; y < rowEnd; y++)
+    {
+        unsigned char *row = pixels + 4 * ((size_t)y * stride);
+
+        // Same depth and fog as the plane shaders, the rows beyond the far distance are filled with the fog color
+
+        const float v = (y + 0.5f) / pass->height;
+        const float depth = (camera->offset / v - 1.0f) * scaleY;
+
+        int fog = 0;
+
+        if (fogEnd > 0)
+        {
+            if (depth >= fogEnd)
+            {
+                for (int x = pass->x0; x < pass->x1; x++)
+                {
+                    M7_Software_Blend(row + 4 * x, fogColor);
+                }
+
+                continue;
+            }
+
+            fog = (int)(fminf(fmaxf((depth - fogStart) / fmaxf(fogEnd - fogStart, 1e-5f), 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+
+        // Start of the row and step per pixel, in texels of the map
+
+        float terms[4];
+        M7_Camera_GetRowTerms(camera, y, pass->height, terms);
+
+        const float u0 = (terms[0] + pass->camPos[0]) * texelsX;
+        const float v0 = (terms[1] + pass->camPos[1]) * texelsY;
+        const float du = terms[2] * texelsX / pass->width;
+        const float dv = terms[3] * texelsY / pass->width;
+
+        int x = pass->x0;
+
+#if defined(M7_SIMD_AVX2)
+        {
+            // The lanes outside of the map are masked out of the gather, so they are never read
+
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 ones = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+
+            const __m256 width = _mm256_set1_ps((float)map->width);
+            const __m256 height = _mm256_set1_ps((float)map->height);
+            const __m256 maxX = _mm256_set1_ps((float)(map->width - 1));
+            const __m256 maxY = _mm256_set1_ps((float)(map->height - 1));
+            const __m256i texelStride = _mm256_set1_epi32(map->width);
+
+            for (; x + 8 <= pass->x1; x += 8)
+            {
+                const __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), lanes);
+
+                __m256 tu = _mm256_add_ps(_mm256_set1_ps(u0), _mm256_mul_ps(px, _mm256_set1_ps(du)));
+                __m256 tv = _mm256_add_ps(_mm256_set1_ps(v0), _mm256_mul_ps(px, _mm256_set1_ps(dv)));
+                __m256 inside = ones;
+
+                if (pass->wrap)
+                {
+                    tu = _mm256_sub_ps(tu, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(tu, width)), width));
+                    tv = _mm256_sub_ps(tv, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(tv, height)), height));
+                }
+                else
+                {
+                    const __m256 outside = _mm256_or_ps(
+                        _mm256_or_ps(_mm256_cmp_ps(tu, zero, _CMP_LT_OQ), _mm256_cmp_ps(tv, zero, _CMP_LT_OQ)),
+                        _mm256_or_ps(_mm256_cmp_ps(tu, width, _CMP_GE_OQ), _mm256_cmp_ps(tv, height, _CMP_GE_OQ)));
+
+                    inside = _mm256_xor_ps(outside, ones);
+                }
+
+                const int mask = _mm256_movemask_ps(inside);
+                if (mask == 0) continue;
+
+                // Same clamp as the scalar loop, the NaN coordinates also giving the last texel
+
+                const __m256i tx = _mm256_cvttps_epi32(_mm256_max_ps(_mm256_min_ps(tu, maxX), zero));
+                const __m256i ty = _mm256_cvttps_epi32(_mm256_max_ps(_mm256_min_ps(tv, maxY), zero));
+                const __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(ty, texelStride), tx);
+
+                uint32_t fetched[8];
+
+                _mm256_storeu_si256((__m256i*)fetched, _mm256_mask_i32gather_epi32(
+                    _mm256_setzero_si256(), (const int*)texels, index, _mm256_castps_si256(inside), 4));
+
+                for (int i = 0; i < 8; i++)
+                {
+                    if (mask & (1 << i))
+                    {
+                        M7_Software_Shade(row + 4 * (x + i), (const unsigned char*)&fetched[i], fog, fogColor);
+                    }
+                }
+            }
+        }
+#endif
+
+        for (; x < pass->x1; x++)
+        {
+            float tu = u0 + (x + 0.5f) * du;
+            float tv = v0 + (x + 0.5f) * dv;
+
+            if (pass->wrap)
+            {
+                tu -= floorf(tu / map->width) * map->width;
+                tv -= floorf(tv / map->height) * map->height;
+            }
+            else if (tu < 0 || tv < 0 || tu >= map->width || tv >= map->height)
+            {
+                continue;
+            }
+
+            // The wrapped coordinates can round below zero or up to the size beyond 2^24 texels,
+            // so both bounds are clamped (the NaN coordinates giving the last texel)
+
+            const int tx = (int)fmaxf(fminf(tu, (float)(map->width - 1)), 0.0f);
+            const int ty = (int)fmaxf(fminf(tv, (float)(map->height - 1)), 0.0f);
+
+            M7_Software_Shade(row + 4 * x, texels + 4 * ((size_t)ty * map->width + tx), fog, fogColor);
+        }
+    }
+}
+
+/**
+ * Composite the visible elements over the rows of the software backend (M7_Job).
+ * Each batch draws all the elements in the rendering order, clipped to its rows, so the batches are independent.
+ *
+ * @param data The pass (M7_SoftwareData).
+ * @param first The first batch of M7_SOFTWARE_BATCH_ROWS rows.
+ * @param count The number of batches.
+ */
+static void M7_Software_ElementsJob(void* data, uint32_t first, uint32_t count)
+{
+    const M7_SoftwareData *pass = (const M7_SoftwareData*)data;
+    const M7_Camera *camera = pass->camera;
+    const M7_ZBuffer *buffer = &camera->world->buffer;
+    const M7_ZBuffer_View *view = camera->view;
+
+    const int rowBegin = pass->y0 + (int)(first * M7_SOFTWARE_BATCH_ROWS);
+    const int rowEnd = (int)fminf((float)pass->y0 + (first + count) * M7_SOFTWARE_BATCH_ROWS, (float)pass->y1);
+
+    unsigned char *pixels = (unsigned char*)camera->software.image.data;
+    const int stride = camera->software.image.width;
+
+    // The elements are projected on the full size target
+
+    const float scaleX = (float)pass->width / camera->target.texture.width;
+    const float scaleY = (float)pass->height / camera->target.texture.height;
+
+    for (uint32_t i = 0; i < view->visibleCount; i++)
+    {
+        const M7_ZBuffer_Element *elem = buffer->elems[view->order[i].index];
+        const struct M7_ZBuffer_Element_SpaceData *onScreen = &view->onScreen[elem->index];
+
+        Rectangle dst = onScreen->rectangle;
+        float centerX = 0, centerY = 0, radiusX = 0, radiusY = 0;
+
+        if (elem->type == M7_ZBT_CIRCLE)
+        {
+            radiusX = onScreen->rectangle.width * scaleX;
+            radiusY = onScreen->rectangle.width * scaleY;
+            centerX = onScreen->position.x * scaleX;
+            centerY = (onScreen->position.y - onScreen->rectangle.width) * scaleY;
+            dst = (Rectangle) { centerX - radiusX, centerY - radiusY, 2 * radiusX, 2 * radiusY };
+        }
+        else
+        {
+            dst = (Rectangle) { dst.x * scaleX, dst.y * scaleY, dst.width * scaleX, dst.height * scaleY };
+        }
+
+        if (dst.width <= 0 || dst.height <= 0) continue;
+
+        // Same checks as M7_ZBuffer_Element_Draw(), the element is skipped when its scale is flipped
+
+        const Image *image = elem->image;
+
+        if (elem->type == M7_ZBT_TEXTURE)
+        {
+            if ((onScreen->scale.x > 0) != (elem->onWorld.scale.x > 0)
+             || (onScreen->scale.y > 0) != (elem->onWorld.scale.y > 0)) continue;
+
+            if (!image || !image->data || image->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) continue;
+        }
+
+        // Pixels whose center is inside the destination
+
+        const int x0 = (int)fmaxf(ceilf(dst.x - 0.5f), 0.0f);
+        const int x1 = (int)fminf(ceilf(dst.x + dst.width - 0.5f), (float)pass->width);
+        const int y0 = (int)fmaxf(ceilf(dst.y - 0.5f), (float)rowBegin);
+        const int y1 = (int)fminf(ceilf(dst.y + dst.height - 0.5f), (float)rowEnd);
+
+        for (int y = y0; y < y1; y++)
+        {
+            unsigned char *row = pixels + 4 * ((size_t)y * stride);
+
+            switch (elem->type)
+            {
+                case M7_ZBT_TEXTURE: {
+
+                    const Rectangle src = elem->onWorld.rectangle;
+                    const unsigned char *texels = (const unsigned char*)image->data;
+
+                    // A negative source size flips the texture, as with DrawTexturePro()
+
+                    float fy = (y + 0.5f - dst.y) / dst.height;
+                    if (src.height < 0) fy = 1.0f - fy;
+
+                    const int ty = (int)fminf(fmaxf(floorf(src.y + fy * fabsf(src.height)), 0.0f), (float)(image->height - 1));
+
+                    for (int x = x0; x < x1; x++)
+                    {
+                        float fx = (x + 0.5f - dst.x) / dst.width;
+                        if (src.width < 0) fx = 1.0f - fx;
+
+                        const int tx = (int)fminf(fmaxf(floorf(src.x + fx * fabsf(src.width)), 0.0f), (float)(image->width - 1));
+                        const unsigned char *texel = texels + 4 * ((size_t)ty * image->width + tx);
+
+                        M7_Software_Blend(row + 4 * x, (Color) {
+                            (unsigned char)((texel[0] * elem->tint.r + 127) / 255),
+                            (unsigned char)((texel[1] * elem->tint.g + 127) / 255),
+                            (unsigned char)((texel[2] * elem->tint.b + 127) / 255),
+                            (unsigned char)((texel[3] * elem->tint.a + 127) / 255)
+                        });
+                    }
+
+                } break;
+
+                case M7_ZBT_RECTANGLE: {
+
+                    for (int x = x0; x < x1; x++)
+                    {
+                        M7_Software_Blend(row + 4 * x, elem->tint);
+                    }
+
+                } break;
+
+                case M7_ZBT_CIRCLE: {
+
+                    const float dy = (y + 0.5f - centerY) / radiusY;
+
+                    for (int x = x0; x < x1; x++)
+                    {
+                        const float dx = (x + 0.5f - centerX) / radiusX;
+                        if (dx * dx + dy * dy <= 1.0f) M7_Software_Blend(row + 4 * x, elem->tint);
+                    }
+
+                } break;
+            }
+        }
+    }
+}
+
+/**
+ * Composite the visible elements of the Mode 7 Z-Buffer with the software backend, in the rendering order.
+ *
+ * @param camera The Mode 7 camera.
+ */
+static void M7_Software_DrawElements(M7_Camera* camera)
+{
+    if (!camera->software.image.data || camera->view->visibleCount == 0) return;
+
+    M7_SoftwareData pass = { .camera = camera };
+
+    M7_Camera_GetViewport(camera, &pass.width, &pass.height);
+
+    pass.x1 = pass.width;
+    pass.y1 = pass.height;
+
+    const uint32_t batchCount = (pass.height + M7_SOFTWARE_BATCH_ROWS - 1) / M7_SOFTWARE_BATCH_ROWS;
+    M7_Camera_ParallelFor(camera, M7_Software_ElementsJob, &pass, batchCount);
+}
+
+/*
+    Picking functions (functions automatically called by the module)
+*/
+
+/**
+ * Get the range of the picking cells of a Mode 7 camera overlapped by a projected element.
+ *
+ * @param camera The Mode 7 camera.
+ * @param elem The Mode 7 Z-Buffer element.
+ * @param cx0 Receives the first column of cells.
+ * @param cy0 Receives the first row of cells.
+ * @param cx1 Receives the last column of cells.
+ * @param cy1 Receives the last row of cells.
+ */
+static void M7_Pick_GetCells(const M7_Camera* camera, const M7_ZBuffer_Element* elem, int* cx0, int* cy0, int* cx1, int* cy1)
+{
+    float x0, y0, x1, y1;
+    M7_ZBuffer_Element_GetBounds(camera->view, elem, &x0, &y0, &x1, &y1);
+
+    // Clamped before the conversion, the bounds of the nearest elements can be far outside of the target
+
+    const float maxX = (float)(camera->pick.columns - 1);
+    const float maxY = (float)(camera->pick.rows - 1);
+
+    *cx0 = (int)fminf(fmaxf(x0 / M7_PICK_CELL_SIZE, 0.0f), maxX);
+    *cy0 = (int)fminf(fmaxf(y0 / M7_PICK_CELL_SIZE, 0.0f), maxY);
+    *cx1 = (int)fminf(fmaxf(x1 / M7_PICK_CELL_SIZE, 0.0f), maxX);
+    *cy1 = (int)fminf(fmaxf(y1 / M7_PICK_CELL_SIZE, 0.0f), maxY);
+}
+
+/**
+ * Bin the draw list of the last frame of a Mode 7 camera in the picking cells, with a counting sort
+ * keeping the elements of each cell in drawing order.
+ *
+ * @param camera The Mode 7 camera.
+ *
+ * @return True if the cells have been built, false if an allocation failed.
+ */
+static bool M7_Pick_Build(M7_Camera* camera)
+{
+    M7_ZBuffer *buffer = &camera->world->buffer;
+    const M7_ZBuffer_View *view = camera->view;
+
+    const int columns = (camera->target.texture.width + M7_PICK_CELL_SIZE - 1) / M7_PICK_CELL_SIZE;
+    const int rows = (camera->target.texture.height + M7_PICK_CELL_SIZE - 1) / M7_PICK_CELL_SIZE;
+
+    if (columns <= 0 || rows <= 0) return false;
+
+    const uint32_t cellCount = (uint32_t)columns * (uint32_t)rows;
+
+    if (!camera->pick.cellStart || columns != camera->pick.columns || rows != camera->pick.rows)
+    {
+        uint32_t *cellStart = (uint32_t*)realloc(camera->pick.cellStart, (cellCount + 1) * sizeof(uint32_t));
+        if (!cellStart) return false;
+
+        camera->pick.cellStart = cellStart;
+        camera->pick.columns = columns;
+        camera->pick.rows = rows;
+    }
+
+    uint32_t *cellStart = camera->pick.cellStart;
+    memset(cellStart, 0, (cellCount + 1) * sizeof(uint32_t));
+
+    // Removing an element moves an entry of the order in its place, so the draw list is bounded
+    // by the element count and the entries of the elements that were not drawn are skipped
+
+    const uint32_t drawCount = (view->visibleCount < buffer->count) ? view->visibleCount : buffer->count;
+    int cx0, cy0, cx1, cy1;
+
+    for (uint32_t i = 0; i < drawCount; i++)
+    {
+        const M7_ZBuffer_Element *elem = buffer->elems[view->order[i].index];
+        if (!view->visible[elem->index]) continue;
+
+        M7_Pick_GetCells(camera, elem, &cx0, &cy0, &cx1, &cy1);
+
+        for (int cy = cy0; cy <= cy1; cy++)
+        {
+            for (int cx = cx0; cx <= cx1; cx++) cellStart[cy * columns + cx]++;
+        }
+    }
+
+    // Each cell then starts at the end of its range, which is filled backwards
+
+    uint32_t total = 0;
+
+    for (uint32_t c = 0; c < cellCount; c++)
+    {
+        total += cellStart[c];
+        cellStart[c] = total;
+    }
+
+    cellStart[cellCount] = total;
+
+    if (total > camera->pick.capacity)
+    {
+        const uint32_t capacity = (total > 2 * camera->pick.capacity) ? total : 2 * camera->pick.capacity;
+
+        uint32_t *entries = (uint32_t*)realloc(camera->pick.entries, capacity * sizeof(uint32_t));
+        if (!entries) return false;
+
+        camera->pick.entries = entries;
+        camera->pick.capacity = capacity;
+    }
+
+    for (uint32_t i = drawCount; i-- > 0;)
+    {
+        const M7_ZBuffer_Element *elem = buffer->elems[view->order[i].index];
+        if (!view->visible[elem->index]) continue;
+
+        M7_Pick_GetCells(camera, elem, &cx0, &cy0, &cx1, &cy1);
+
+        for (int cy = cy0; cy <= cy1; cy++)
+        {
+            for (int cx = cx0; cx <= cx1; cx++) camera->pick.entries[--cellStart[cy * columns + cx]] = i;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Get the elements of the picking cell of a Mode 7 camera containing a screen point,
+ * binning the draw list of the last frame first if it has not been since.
+ *
+ * @param camera The Mode 7 camera.
+ * @param point The screen point.
+ * @param count Receives the number of elements of the cell.
+ *
+ * @return The positions in the draw list of the elements of the cell, in drawing order
+ *         (NULL with a count of zero if the point is outside of the target or there is nothing to pick).
+ */
+static const uint32_t* M7_Pick_GetCell(M7_Camera* camera, Vector2 point, uint32_t* count)
+{
+    *count = 0;
+
+    if (!camera->pick.valid || camera->view->orderDirty)
+    {
+        camera->pick.valid = M7_Pick_Build(camera);
+        if (!camera->pick.valid) return NULL;
+    }
+
+    if (!(point.x >= 0 && point.x < camera->target.texture.width
+       && point.y >= 0 && point.y < camera->target.texture.height))
+    {
+        return NULL;
+    }
+
+    const int cx = (int)(point.x / M7_PICK_CELL_SIZE);
+    const int cy = (int)(point.y / M7_PICK_CELL_SIZE);
+
+    const uint32_t cell = cy * camera->pick.columns + cx;
+    *count = camera->pick.cellStart[cell + 1] - camera->pick.cellStart[cell];
+
+    return camera->pick.entries + camera->pick.cellStart[cell];
+}
+
+/*
+    World functions (functions automatically called by the module)
+*/
+
+/**
+ * Load a new world holding the elements of a camera.
+ *
+ * @param capacity The number of elements the world can hold before having to grow.
+ *
+ * @return The new world, with a single reference, or NULL if the allocation failed.
+ */
+static M7_World* M7_World_Load(uint32_t capacity)
+{
+    M7_World *world = (M7_World*)malloc(sizeof(M7_World));
+    if (!world) return NULL;
+
+    world->buffer = M7_ZBuffer_Load(capacity);
+    world->refCount = 1;
+
+    return world;
+}
+
+/**
+ * Release a reference to a world, unloading it once no camera renders its elements anymore.
+ *
+ * @param world The world to release.
+ */
+static void M7_World_Release(M7_World* world)
+{
+    if (!world || --world->refCount > 0) return;
+
+    M7_ZBuffer_Unload(&world->buffer);
+    free(world);
+}
+
+/*
+    Z-Buffer functions management (functions automatically called by the module)
+*/
+
+/**
+ * Load a new Mode 7 Z-Buffer with a specified initial capacity.
+ *
+ * @param capacity The number of elements the Z-Buffer can hold before having to grow.
+ *
+ * @return The initialized Mode 7 Z-Buffer.
+ */
+static M7_ZBuffer M7_ZBuffer_Load(uint32_t capacity)
+{
+    M7_ZBuffer buffer = {0};
+
+    if (capacity > 0)
+    {
+        M7_ZBuffer_Grow(&buffer, (capacity + M7_POOL_CHUNK_SIZE - 1) / M7_POOL_CHUNK_SIZE);
+    }
+
+    return buffer;
+}
+
+/**
+ * Unload a Mode 7 Z-Buffer, freeing associated resources.
+ * The views of the buffer belong to the cameras and must have been unloaded beforehand.
+ *
+ * @param buffer The Mode 7 Z-Buffer to unload.
+ */
+static void M7_ZBuffer_Unload(M7_ZBuffer* buffer)
+{
+    if (buffer->transforms.data)
+    {
+        free(buffer->transforms.data);
+        buffer->transforms = (M7_ZBuffer_Transforms) { 0 };
+    }
+
+    if (buffer->elems)
+    {
+        free(buffer->elems);
+        buffer->elems = NULL;
+    }
+
+    if (buffer->freeSlots)
+    {
+        free(buffer->freeSlots);
+        buffer->freeSlots = NULL;
+    }
+
+    if (buffer->grid)
+    {
+        M7_SpatialIndex_Unload(buffer->grid);
+        buffer->grid = NULL;
+    }
+
+    if (buffer->chunks)
+    {
+        for (uint32_t i = 0; i < buffer->chunkCount; i++)
+        {
+            free(buffer->chunks[i]);
+        }
+
+        free(buffer->chunks);
+        buffer->chunks = NULL;
+    }
+
+    buffer->chunkCount = 0;
+    buffer->capacity = 0;
+    buffer->freeCount = 0;
+    buffer->count = 0;
+}
+
+/**
+ * Grow a Mode 7 Z-Buffer by chunks of M7_POOL_CHUNK_SIZE elements.
+ * The existing elements are not moved, only the arrays indexing them, the transform arrays and the arrays
+ * of the views are reallocated, once for all the chunks, so growing by many chunks at once avoids copying
+ * them again for each chunk.
+ *
+ * @param buffer The Mode 7 Z-Buffer to grow.
+ * @param chunkCount The number of chunks to add.
+ *
+ * @return True if the buffer has grown, false if an allocation failed.
+ */
+static bool M7_ZBuffer_Grow(M7_ZBuffer* buffer, uint32_t chunkCount)
+{
+    const uint32_t capacity = buffer->capacity + chunkCount * M7_POOL_CHUNK_SIZE;
+
+    M7_ZBuffer_Element **chunks = (M7_ZBuffer_Element**)realloc(buffer->chunks, (buffer->chunkCount + chunkCount) * sizeof(M7_ZBuffer_Element*));
+    if (!chunks) return false;
+
+    buffer->chunks = chunks;
+
+    uint32_t added = 0;
+
+    while (added < chunkCount)
+    {
+        M7_ZBuffer_Element *chunk = (M7_ZBuffer_Element*)calloc(M7_POOL_CHUNK_SIZE, sizeof(M7_ZBuffer_Element));
+        if (!chunk) break;
+
+        chunks[buffer->chunkCount + added++] = chunk;
+    }
+
+    M7_ZBuffer_Element **elems = (M7_ZBuffer_Element**)realloc(buffer->elems, capacity * sizeof(M7_ZBuffer_Element*));
+    if (elems) buffer->elems = elems;
+
+    uint32_t *freeSlots = (uint32_t*)realloc(buffer->freeSlots, capacity * sizeof(uint32_t));
+    if (freeSlots) buffer->freeSlots = freeSlots;
+
+    // The views may be left larger than the buffer if another allocation fails, which does no harm
+
+    bool viewsGrown = true;
+
+    for (M7_ZBuffer_View *view = buffer->views; view; view = view->next)
+    {
+        viewsGrown = viewsGrown && M7_ZBuffer_View_Grow(view, capacity, buffer->count);
+    }
+
+    // The transform arrays share one allocation, they are copied since their stride changes
+
+    float *data = (float*)malloc(6 * capacity * sizeof(float));
+
+    const bool gridGrown = !buffer->grid || M7_SpatialIndex_Grow(buffer->grid, capacity);
+
+    if (added < chunkCount || !elems || !freeSlots || !viewsGrown || !gridGrown || !data)
+    {
+        for (uint32_t i = 0; i < added; i++) free(chunks[buffer->chunkCount + i]);
+        free(data);
+        return false;
+    }
+
+    M7_ZBuffer_Transforms *tr = &buffer->transforms;
+    float **arrays[6] = {
+        &tr->positionX, &tr->positionY, &tr->scaleX, &tr->scaleY,
+        &tr->width, &tr->height
+    };
+
+    for (int i = 0; i < 6; i++)
+    {
+        float *array = data + i * capacity;
+        for (uint32_t j = 0; j < buffer->count; j++) array[j] = (*arrays[i])[j];
+        *arrays[i] = array;
+    }
+
+    free(tr->data);
+    tr->data = data;
+
+    buffer->chunkCount += chunkCount;
+
+    // The new slots are pushed in reverse order so that they are used in increasing order
+
+    for (uint32_t i = capacity - buffer->capacity; i > 0; i--)
+    {
+        buffer->freeSlots[buffer->freeCount++] = buffer->capacity + i - 1;
+    }
+
+    buffer->capacity = capacity;
+
+    return true;
+}
+
+/**
+ * Load the view of a camera on the elements of a Mode 7 Z-Buffer and link it to the buffer,
+ * so that it is kept in step with the transform arrays when elements are added or removed.
+ * None of the elements has been projected by the view yet, all are projected by its first update.
+ *
+ * @param buffer The Mode 7 Z-Buffer.
+ *
+ * @return The new view, or NULL if an allocation failed.
+ */
+static M7_ZBuffer_View* M7_ZBuffer_View_Load(M7_ZBuffer* buffer)
+{
+    M7_ZBuffer_View *view = (M7_ZBuffer_View*)calloc(1, sizeof(M7_ZBuffer_View));
+    if (!view) return NULL;
+
+    view->sortMode = M7_SORT_AUTO;
+    view->lastSort = M7_SORT_NONE;
+
+    if (buffer->capacity > 0 && !M7_ZBuffer_View_Grow(view, buffer->capacity, 0))
+    {
+        M7_ZBuffer_View_Unload(NULL, view);
+        return NULL;
+    }
+
+    // The elements are projected on the first update, before their key is used
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        view->order[i] = (M7_ZBuffer_SortKey) { 0, i };
+        view->orderOf[i] = i;
+        view->revisions[i] = 0;
+        view->visible[i] = false;
+    }
+
+    view->next = buffer->views;
+    buffer->views = view;
+
+    return view;
+}
+
+/**
+ * Unlink the view of a camera from its Mode 7 Z-Buffer, then free it.
+ *
+ * @param buffer The Mode 7 Z-Buffer of the view (NULL if it has not been linked).
+ * @param view The view to unload.
+ */
+static void M7_ZBuffer_View_Unload(M7_ZBuffer* buffer, M7_ZBuffer_View* view)
+{
+    for (M7_ZBuffer_View **link = buffer ? &buffer->views : NULL; link && *link; link = &(*link)->next)
+    {
+        if (*link == view)
+        {
+            *link = view->next;
+            break;
+        }
+    }
+
+    free(view->data);
+    free(view->onScreen);
+    free(view->revisions);
+    free(view->visible);
+    free(view->order);
+    free(view->orderTemp);
+    free(view->orderOf);
+    free(view->batchUpdated);
+    free(view);
+}
+
+/**
+ * Grow the arrays of the view of a camera to the capacity of its Mode 7 Z-Buffer.
+ *
+ * @param view The view to grow.
+ * @param capacity The new capacity of the arrays.
+ * @param count The number of elements of the buffer, whose data is kept.
+ *
+ * @return True if the view has grown, false if an allocation failed.
+ */
+static bool M7_ZBuffer_View_Grow(M7_ZBuffer_View* view, uint32_t capacity, uint32_t count)
+{
+    if (capacity <= view->capacity) return true;
+
+    struct M7_ZBuffer_Element_SpaceData *onScreen = (struct M7_ZBuffer_Element_SpaceData*)realloc(view->onScreen, capacity * sizeof(struct M7_ZBuffer_Element_SpaceData));
+    if (onScreen) view->onScreen = onScreen;
+
+    uint32_t *revisions = (uint32_t*)realloc(view->revisions, capacity * sizeof(uint32_t));
+    if (revisions) view->revisions = revisions;
+
+    bool *visible = (bool*)realloc(view->visible, capacity * sizeof(bool));
+    if (visible) view->visible = visible;
+
+    M7_ZBuffer_SortKey *order = (M7_ZBuffer_SortKey*)realloc(view->order, capacity * sizeof(M7_ZBuffer_SortKey));
+    if (order) view->order = order;
+
+    M7_ZBuffer_SortKey *orderTemp = (M7_ZBuffer_SortKey*)realloc(view->orderTemp, capacity * sizeof(M7_ZBuffer_SortKey));
+    if (orderTemp) view->orderTemp = orderTemp;
+
+    uint32_t *orderOf = (uint32_t*)realloc(view->orderOf, capacity * sizeof(uint32_t));
+    if (orderOf) view->orderOf = orderOf;
+
+    const uint32_t batchCount = (capacity + M7_JOB_BATCH_SIZE - 1) / M7_JOB_BATCH_SIZE;
+    uint32_t *batchUpdated = (uint32_t*)realloc(view->batchUpdated, batchCount * sizeof(uint32_t));
+    if (batchUpdated) view->batchUpdated = batchUpdated;
+
+    // The projection arrays share one allocation, they are copied since their stride changes
+
+    float *data = (float*)malloc(3 * capacity * sizeof(float));
+
+    if (!onScreen || !revisions || !visible || !order || !orderTemp || !orderOf || !batchUpdated || !data)
+    {
+        free(data);
+        return false;
+    }
+
+    float **arrays[3] = { &view->screenX, &view->screenY, &view->distance };
+
+    for (int i = 0; i < 3; i++)
+    {
+        float *array = data + i * capacity;
+        for (uint32_t j = 0; j < count; j++) array[j] = (*arrays[i])[j];
+        *arrays[i] = array;
+    }
+
+    free(view->data);
+    view->data = data;
+
+    view->capacity = capacity;
+
+    return true;
+}
+
+/**
+ * Get the element stored in a slot of a Mode 7 Z-Buffer.
+ *
+ * @param buffer The Mode 7 Z-Buffer.
+ * @param slot The slot of the element.
+ *
+ * @return A pointer to the element of the slot, or NULL if the slot is out of the buffer.
+ */
+static M7_ZBuffer_Element* M7_ZBuffer_Element_Get(M7_ZBuffer* buffer, uint32_t slot)
+{
+    if (slot >= buffer->capacity) return NULL;
+    return buffer->chunks[slot / M7_POOL_CHUNK_SIZE] + (slot % M7_POOL_CHUNK_SIZE);
+}
+
+/**
+ * Add a Mode 7 Z-Buffer element to the buffer.
+ * The element is placed in a free slot, the buffer grows if there is none left.
+ *
+ * @param buffer The Mode 7 Z-Buffer.
+ * @param elem The Mode 7 Z-Buffer element to add.
+ *
+ * @return A pointer to the added Mode 7 Z-Buffer element, or NULL if the buffer could not grow.
+ */
+static M7_ZBuffer_Element* M7_ZBuffer_Element_Add(M7_ZBuffer* buffer, M7_ZBuffer_Element* elem)
+{
+    // The buffer grows by half its size, so filling it element by element copies its arrays a logarithmic number of times
+
+    if (buffer->freeCount == 0 && !M7_ZBuffer_Grow(buffer, buffer->chunkCount / 2 + 1)) return NULL;
+
+    const uint32_t slot = buffer->freeSlots[--buffer->freeCount];
+    M7_ZBuffer_Element *ptr = M7_ZBuffer_Element_Get(buffer, slot);
+
+    const uint32_t generation = ptr->generation;
+    *ptr = *elem;
+
+    ptr->slot = slot;
+    ptr->generation = generation;
+    ptr->index = buffer->count;
+    ptr->grid = buffer->grid;
+    ptr->alive = true;
+    ptr->revision = 1;
+
+    if (buffer->grid) M7_SpatialIndex_Insert(buffer->grid, ptr);
+
+    // The element is projected by each view on its next update, before its key is used
+
+    buffer->elems[ptr->index] = ptr;
+
+    for (M7_ZBuffer_View *view = buffer->views; view; view = view->next)
+    {
+        view->order[buffer->count] = (M7_ZBuffer_SortKey) { 0, ptr->index };
+        view->orderOf[ptr->index] = buffer->count;
+        view->revisions[ptr->index] = 0;
+        view->visible[ptr->index] = false;
+    }
+
+    buffer->count++;
+
+    return ptr;
+}
+
+/**
+ * Remove a Mode 7 Z-Buffer element from the buffer.
+ * In the rendering order of each view, the last element takes its place, which is then fixed by the next sort,
+ * and the last element of the transform arrays and of the projection arrays of the views is moved to its index.
+ *
+ * @param buffer The Mode 7 Z-Buffer.
+ * @param elem The Mode 7 Z-Buffer element to remove.
+ *
+ * @return True if the element has been removed, false if it was not alive.
+ */
+static bool M7_ZBuffer_Element_Remove(M7_ZBuffer* buffer, M7_ZBuffer_Element* elem)
+{
+    if (!elem->alive) return false;
+
+    const uint32_t index = elem->index;
+    const uint32_t last = --buffer->count;
+
+    for (M7_ZBuffer_View *view = buffer->views; view; view = view->next)
+    {
+        // Fill the hole in the rendering order with its last entry
+
+        const uint32_t position = view->orderOf[index];
+        view->order[position] = view->order[last];
+        view->orderOf[view->order[position].index] = position;
+
+        // Fill the hole in the projection arrays with their last element
+
+        if (index != last)
+        {
+            view->screenX[index] = view->screenX[last];
+            view->screenY[index] = view->screenY[last];
+            view->distance[index] = view->distance[last];
+            view->onScreen[index] = view->onScreen[last];
+            view->revisions[index] = view->revisions[last];
+            view->visible[index] = view->visible[last];
+
+            const uint32_t lastPosition = view->orderOf[last];
+            view->order[lastPosition].index = index;
+            view->orderOf[index] = lastPosition;
+        }
+
+        // Forces the partition and the sort of the next frame
+
+        view->orderDirty = true;
+    }
+
+    // Fill the hole in the transform arrays with their last element
+
+    if (index != last)
+    {
+        M7_ZBuffer_Transforms *tr = &buffer->transforms;
+
+        tr->positionX[index] = tr->positionX[last];
+        tr->positionY[index] = tr->positionY[last];
+        tr->scaleX[index] = tr->scaleX[last];
+        tr->scaleY[index] = tr->scaleY[last];
+        tr->width[index] = tr->width[last];
+        tr->height[index] = tr->height[last];
+
+        buffer->elems[index] = buffer->elems[last];
+        buffer->elems[index]->index = index;
+    }
+
+    if (elem->grid)
+    {
+        M7_SpatialIndex_Remove(elem->grid, elem->slot);
+        elem->grid = NULL;
+    }
+
+    elem->alive = false;
+    elem->generation++;
+
+    buffer->freeSlots[buffer->freeCount++] = elem->slot;
+
+    return true;
+}
+
+/**
+ * Copy the world data of a Mode 7 Z-Buffer element needed by the projection to the transform arrays.
+ *
+ * @param buffer The Mode 7 Z-Buffer.
+ * @param elem The Mode 7 Z-Buffer element to copy.
+ */
+static void M7_ZBuffer_Element_Sync(M7_ZBuffer* buffer, const M7_ZBuffer_Element* elem)
+{
+    M7_ZBuffer_Transforms *tr = &buffer->transforms;
+    const uint32_t i = elem->index;
+
+    tr->positionX[i] = elem->onWorld.position.x;
+    tr->positionY[i] = elem->onWorld.position.y;
+    tr->scaleX[i] = elem->onWorld.scale.x;
+    tr->scaleY[i] = elem->onWorld.scale.y;
+    tr->width[i] = elem->onWorld.rectangle.width;
+    tr->height[i] = elem->onWorld.rectangle.height;
+}
+
+/**
+ * Update the screen data of a Mode 7 Z-Buffer element in a view from its projection in the arrays of the view.
+ *
+ * @param view The view of the camera.
+ * @param elem The Mode 7 Z-Buffer element to update.
+ */
+static void M7_ZBuffer_Element_Update(M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem)
+{
+    const uint32_t i = elem->index;
+    struct M7_ZBuffer_Element_SpaceData *onScreen = &view->onScreen[i];
+
+    const float size = view->distance[i];
+
+    onScreen->scale.x = (size * elem->onWorld.scale.x) / elem->onWorld.rectangle.width;
+    onScreen->scale.y = (size * elem->onWorld.scale.y) / elem->onWorld.rectangle.height;
+
+    onScreen->rectangle = (Rectangle) {
+
+        view->screenX[i] - (elem->onWorld.rectangle.width * onScreen->scale.x) * 0.5f,
+        view->screenY[i] - elem->onWorld.rectangle.height * onScreen->scale.y,
+
+        elem->onWorld.rectangle.width * onScreen->scale.x,
+        elem->onWorld.rectangle.width * onScreen->scale.y
+
+    };
+
+    onScreen->position = (Vector2) { view->screenX[i], view->screenY[i] };
+
+    view->revisions[i] = elem->revision;
+}
+
+/**
+ * Check if a projected Mode 7 Z-Buffer element overlaps the render target of a view.
+ * The elements behind the camera have a negative distance and are never visible.
+ *
+ * @param view The view of the camera.
+ * @param elem The Mode 7 Z-Buffer element to check.
+ * @param width The width of the render target.
+ * @param height The height of the render target.
+ * @param minDistance The distance of the elements at the far distance of the camera (0 for no limit).
+ *
+ * @return True if the element can be seen on the render target.
+ */
+static bool M7_ZBuffer_Element_IsVisible(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem, float width, float height, float minDistance)
+{
+    if (!(view->distance[elem->index] > minDistance)) return false;
+
+    float x0, y0, x1, y1;
+    M7_ZBuffer_Element_GetBounds(view, elem, &x0, &y0, &x1, &y1);
+
+    return (x1 >= 0 && x0 <= width && y1 >= 0 && y0 <= height);
+}
 
-static void M7_ZBuffer_Element_Update(M7_ZBuffer_Element* elem, M7_Camera* camera);
-static void M7_ZBuffer_Element_Draw(M7_ZBuffer_Element* elem);
+/**
+ * Get the screen bounds of a projected Mode 7 Z-Buffer element in a view.
+ *
+ * @param view The view of the camera.
+ * @param elem The Mode 7 Z-Buffer element.
+ * @param x0 Receives the left edge of the element.
+ * @param y0 Receives the top edge of the element.
+ * @param x1 Receives the right edge of the element.
+ * @param y1 Receives the bottom edge of the element.
+ */
+static void M7_ZBuffer_Element_GetBounds(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem, float* x0, float* y0, float* x1, float* y1)
+{
+    const struct M7_ZBuffer_Element_SpaceData *onScreen = &view->onScreen[elem->index];
+    const Rectangle rec = onScreen->rectangle;
 
-static int M7_ZBuffer_Compare(const void* a, const void* b);
-static void M7_ZBuffer_Sort(M7_ZBuffer* buffer);
+    if (elem->type == M7_ZBT_CIRCLE)
+    {
+        // Same circle as M7_ZBuffer_Element_Draw()
 
-static void M7_ZBuffer_Update(M7_Camera* camera);
-static void M7_ZBuffer_Draw(M7_ZBuffer* buffer);
+        const float radius = fabsf(rec.width);
+        *x0 = onScreen->position.x - radius, *x1 = onScreen->position.x + radius;
+        *y0 = onScreen->position.y - rec.width - radius, *y1 = onScreen->position.y - rec.width + radius;
+    }
+    else
+    {
+        // The rectangle is reversed when the world scale is negative
 
-/*
-    Camera system functions
-*/
+        *x0 = fminf(rec.x, rec.x + rec.width), *x1 = fmaxf(rec.x, rec.x + rec.width);
+        *y0 = fminf(rec.y, rec.y + rec.height), *y1 = fmaxf(rec.y, rec.y + rec.height);
+    }
+}
 
 /**
- * Load a Mode 7 camera with specified parameters.
+ * Check if a screen point is covered by a projected Mode 7 Z-Buffer element in a view, as drawn by
+ * M7_ZBuffer_Element_Draw() (the whole rectangle of the textures, whatever the alpha of their texels).
  *
- * @param screenWidth The screen width.
- * @param screenHeight The screen height.
- * @param position The camera's initial position.
- * @param rotation The camera's initial rotation.
- * @param zoom The camera's initial zoom.
- * @param fov The camera's initial field of view.
- * @param offset The camera's initial offset.
- * @param maxSprites The maximum number of sprites in the ZBuffer.
+ * @param view The view of the camera.
+ * @param elem The Mode 7 Z-Buffer element.
+ * @param point The screen point.
  *
- * @return The initialized Mode 7 camera.
+ * @return True if the point is covered by the element.
  */
-M7_Camera M7_Camera_Load(int screenWidth, int screenHeight, Vector2 position, float rotation, float zoom, float fov, float offset, uint32_t maxSprites)
+static bool M7_ZBuffer_Element_Contains(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem, Vector2 point)
 {
-    M7_Camera camera = {0};
+    const struct M7_ZBuffer_Element_SpaceData *onScreen = &view->onScreen[elem->index];
 
-    camera.aspect = (screenWidth > screenHeight)
-        ? ((float)screenWidth / (float)screenHeight)
-        : ((float)screenHeight / (float)screenWidth);
+    if (elem->type == M7_ZBT_CIRCLE)
+    {
+        const float radius = onScreen->rectangle.width;
+        const float dx = point.x - onScreen->position.x;
+        const float dy = point.y - (onScreen->position.y - radius);
 
-    Shader shader = LoadShaderFromMemory(0, M7_PlaneFragment);
-    camera.planeProgram.shader = shader;
+        return (dx * dx + dy * dy <= radius * radius);
+    }
 
-    camera.planeProgram.locMapTex  = GetShaderLocation(shader, "map");
-    camera.planeProgram.locMapSize = GetShaderLocation(shader, "mapSize");
-    camera.planeProgram.locCamPos  = GetShaderLocation(shader, "camPos");
-    camera.planeProgram.locCamRot  = GetShaderLocation(shader, "camRot");
-    camera.planeProgram.locZoom    = GetShaderLocation(shader, "zoom");
-    camera.planeProgram.locFOV     = GetShaderLocation(shader, "fov");
-    camera.planeProgram.locOffset  = GetShaderLocation(shader, "offset");
-    camera.planeProgram.locWrap    = GetShaderLocation(shader, "wrap");
+    // The textures with an unintentionally flipped scale are not drawn
 
-    camera.target = LoadRenderTexture(screenWidth, screenHeight);
-    camera.buffer = M7_ZBuffer_Load(maxSprites);
+    if (elem->type == M7_ZBT_TEXTURE
+      && ( (onScreen->scale.x > 0) != (elem->onWorld.scale.x > 0)
+        || (onScreen->scale.y > 0) != (elem->onWorld.scale.y > 0) ))
+    {
+        return false;
+    }
 
-    M7_Camera_SetPosition(&camera, position);
-    M7_Camera_SetRotation(&camera, rotation);
-    M7_Camera_SetOffset(&camera, offset);
-    M7_Camera_SetZoom(&camera, zoom);
-    M7_Camera_SetFOV(&camera, fov);
+    float x0, y0, x1, y1;
+    M7_ZBuffer_Element_GetBounds(view, elem, &x0, &y0, &x1, &y1);
 
-    return camera;
+    return (point.x >= x0 && point.x < x1 && point.y >= y0 && point.y < y1);
 }
 
 /**
- * Unload a Mode 7 camera, freeing associated resources.
+ * Mark a Mode 7 Z-Buffer element as dirty for all the views by bumping its revision, and queue it
+ * in the spatial index of its buffer if any so that its cell is updated on the next frame.
  *
- * @param camera The camera to be unloaded.
+ * @param elem The Mode 7 Z-Buffer element.
  */
-void M7_Camera_Unload(M7_Camera* camera)
+static void M7_ZBuffer_Element_Touch(M7_ZBuffer_Element* elem)
 {
-    UnloadShader(camera->planeProgram.shader);
-    UnloadRenderTexture(camera->target);
-    M7_ZBuffer_Unload(&camera->buffer);
+    // Zero is kept for the elements that a view has never projected
 
-    camera->target.id = camera->target.texture.id = 0;
-    camera->planeProgram.shader.id = 0;
+    if (++elem->revision == 0) elem->revision = 1;
+
+    M7_SpatialIndex *grid = elem->grid;
+
+    if (grid && !grid->queued[elem->slot])
+    {
+        grid->queued[elem->slot] = true;
+        grid->moved[grid->movedCount++] = elem->slot;
+    }
 }
 
 /**
- * Update the camera for rendering a single plane.
+ * Draw a Mode 7 Z-Buffer element as projected in a view.
  *
- * @param camera The camera to update.
- * @param texture The texture of the plane.
- * @param position The position of the plane.
- * @param scale The scale of the plane.
- * @param wrap The wrap mode for the plane.
- * @param backgroundColor The background color.
+ * @param view The view of the camera.
+ * @param elem The Mode 7 Z-Buffer element to draw.
  */
-void M7_Camera_Update(M7_Camera* camera, Texture2D texture, Vector2 position, Vector2 scale, int wrap, Color backgroundColor)
+static void M7_ZBuffer_Element_Draw(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem)
 {
-    M7_Camera_Begin(camera, backgroundColor);
-        M7_Camera_DrawPlane(camera, texture, position, (Vector2) {
-                (texture.width * scale.x) * 0.5f,
-                (texture.height * scale.y) * 0.5f
-            }, scale, wrap);
-    M7_Camera_End(camera);
+    const struct M7_ZBuffer_Element_SpaceData *onScreen = &view->onScreen[elem->index];
+
+    switch (elem->type)
+    {
+        case M7_ZBT_TEXTURE: {
+
+            // Checks whether the scale is unintentionally flipped.
+            // (Occurs when the object is behind the camera)
+
+            if ( (onScreen->scale.x > 0) == (elem->onWorld.scale.x > 0)
+              && (onScreen->scale.y > 0) == (elem->onWorld.scale.y > 0) )
+            {
+                DrawTexturePro(
+                    elem->texture,
+                    elem->onWorld.rectangle,
+                    onScreen->rectangle,
+                    (Vector2) {0}, 0, elem->tint);
+            }
+
+        } break;
+
+        case M7_ZBT_RECTANGLE: {
+            DrawRectangleRec(onScreen->rectangle, elem->tint);
+        } break;
+
+        case M7_ZBT_CIRCLE: {
+            Vector2 pos = onScreen->position;
+            pos.y -= onScreen->rectangle.width;
+            DrawCircleV(pos, onScreen->rectangle.width, elem->tint);
+        } break;
+    }
 }
 
 /**
- * Begin rendering with the Mode 7 camera.
+ * Get the depth of a Mode 7 Z-Buffer element for the depth buffer mode.
+ * The depth is given in the view space of the ortho projection that raylib uses for the
+ * render textures (between -1 for the farthest and 0 for the nearest), and is decreasing
+ * with the distance of the element, which is its approximate size on the screen.
  *
- * @param camera The camera to begin rendering with.
- * @param backgroundColor The background color.
+ * @param view The view of the camera.
+ * @param elem The Mode 7 Z-Buffer element.
+ *
+ * @return The depth of the element.
  */
-void M7_Camera_Begin(M7_Camera* camera, Color backgroundColor)
+static float M7_ZBuffer_Element_GetDepth(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem)
 {
-    BeginTextureMode(camera->target);
-    ClearBackground(backgroundColor);
+    return -1.0f / (1.0f + fmaxf(view->distance[elem->index], 0.0f));
 }
 
 /**
- * End rendering with the Mode 7 camera.
+ * Draw a Mode 7 Z-Buffer element at its depth, for the depth buffer mode.
+ * The vertices are emitted directly with rlgl as raylib's shape and texture functions
+ * do not allow to specify the depth.
  *
- * @param camera The camera to end rendering with.
+ * @param view The view of the camera.
+ * @param elem The Mode 7 Z-Buffer element to draw.
  */
-void M7_Camera_End(M7_Camera* camera)
+static void M7_ZBuffer_Element_DrawDepth(const M7_ZBuffer_View* view, const M7_ZBuffer_Element* elem)
 {
-    M7_ZBuffer_Update(camera);
+    const struct M7_ZBuffer_Element_SpaceData *onScreen = &view->onScreen[elem->index];
 
-    M7_ZBuffer_Sort(&camera->buffer);
-    M7_ZBuffer_Draw(&camera->buffer);
+    const float z = M7_ZBuffer_Element_GetDepth(view, elem);
+    const Rectangle dst = onScreen->rectangle;
+    const Color tint = elem->tint;
 
-    EndTextureMode();
-}
+    switch (elem->type)
+    {
+        case M7_ZBT_TEXTURE: {
 
-/**
- * Draw a plane using the Mode 7 camera.
- *
- * TODO: Add parameter 'Rectangle source'
- *       and make the shader compatible 
- *       with this new feature.
- *
- * @param camera The camera to use for drawing.
- * @param texture The texture of the plane.
- * @param position The position of the plane.
- * @param origin The origin of the plane.
- * @param scale The scale of the plane.
- * @param wrap The wrap mode for the plane.
- */
-void M7_Camera_DrawPlane(M7_Camera* camera, Texture2D texture, Vector2 position, Vector2 origin, Vector2 scale, int wrap)
-{
-    const float mapSize[2] = {
-        texture.width * scale.x,
-        texture.height * scale.y
-    };
+            // Same checks and texture coordinates as M7_ZBuffer_Element_Draw() with DrawTexturePro()
 
-    const float camPos[2] = {
-        camera->position.x + position.x + origin.x,
-        camera->position.y + position.y + origin.y
-    };
+            if ( (onScreen->scale.x > 0) != (elem->onWorld.scale.x > 0)
+              || (onScreen->scale.y > 0) != (elem->onWorld.scale.y > 0) )
+            {
+                return;
+            }
 
-    SetShaderValue(camera->planeProgram.shader, camera->planeProgram.locMapSize, mapSize, SHADER_UNIFORM_VEC2);
-    SetShaderValue(camera->planeProgram.shader, camera->planeProgram.locCamPos, camPos, SHADER_UNIFORM_VEC2);
-    SetShaderValue(camera->planeProgram.shader, camera->planeProgram.locWrap, &wrap, SHADER_UNIFORM_INT);
+            const Rectangle src = elem->onWorld.rectangle;
+            const float w = elem->texture.width, h = elem->texture.height;
 
-    BeginShaderMode(camera->planeProgram.shader);
-        SetShaderValueTexture(camera->planeProgram.shader, camera->planeProgram.locMapTex, texture);
-        DrawTexture(camera->target.texture, 0, 0, WHITE);
-    EndShaderMode();
+            const float srcW = fabsf(src.width), srcH = fabsf(src.height);
+
+            float u0 = src.x / w, u1 = (src.x + srcW) / w;
+            float v0 = src.y / h, v1 = (src.y + srcH) / h;
+
+            if (src.width < 0) { float t = u0; u0 = u1; u1 = t; }
+            if (src.height < 0) { float t = v0; v0 = v1; v1 = t; }
+
+            rlSetTexture(elem->texture.id);
+            rlBegin(RL_QUADS);
+                rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+                rlTexCoord2f(u0, v0); rlVertex3f(dst.x, dst.y, z);
+                rlTexCoord2f(u0, v1); rlVertex3f(dst.x, dst.y + dst.height, z);
+                rlTexCoord2f(u1, v1); rlVertex3f(dst.x + dst.width, dst.y + dst.height, z);
+                rlTexCoord2f(u1, v0); rlVertex3f(dst.x + dst.width, dst.y, z);
+            rlEnd();
+            rlSetTexture(0);
+
+        } break;
+
+        case M7_ZBT_RECTANGLE: {
+
+            rlSetTexture(rlGetTextureIdDefault());
+            rlBegin(RL_QUADS);
+                rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+                rlTexCoord2f(0, 0); rlVertex3f(dst.x, dst.y, z);
+                rlTexCoord2f(0, 1); rlVertex3f(dst.x, dst.y + dst.height, z);
+                rlTexCoord2f(1, 1); rlVertex3f(dst.x + dst.width, dst.y + dst.height, z);
+                rlTexCoord2f(1, 0); rlVertex3f(dst.x + dst.width, dst.y, z);
+            rlEnd();
+            rlSetTexture(0);
+
+        } break;
+
+        case M7_ZBT_CIRCLE: {
+
+            const float radius = dst.width;
+            const Vector2 center = { onScreen->position.x, onScreen->position.y - radius };
+            const int segments = 36;
+
+            rlSetTexture(rlGetTextureIdDefault());
+            rlBegin(RL_TRIANGLES);
+                rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+                for (int i = 0; i < segments; i++)
+                {
+                    const float a0 = (2 * PI * i) / segments;
+                    const float a1 = (2 * PI * (i + 1)) / segments;
+
+                    rlTexCoord2f(0, 0); rlVertex3f(center.x, center.y, z);
+                    rlTexCoord2f(0, 0); rlVertex3f(center.x + cosf(a1) * radius, center.y + sinf(a1) * radius, z);
+                    rlTexCoord2f(0, 0); rlVertex3f(center.x + cosf(a0) * radius, center.y + sinf(a0) * radius, z);
+                }
+            rlEnd();
+            rlSetTexture(0);
+
+        } break;
+    }
 }
 
 /**
- * Render the final view of the camera to the screen.
+ * Compare the sort keys of two entries of the rendering order.
  *
- * @param camera The camera to render.
+ * @param a Pointer to the first entry.
+ * @param b Pointer to the second entry.
+ *
+ * @return Negative if the first element is closer, positive if the second element is closer, or zero if they are at the same distance.
  */
-void M7_Camera_Render(M7_Camera* camera)
+static int M7_ZBuffer_Compare(const void* a, const void* b)
 {
-    DrawTexturePro(camera->target.texture,
-        (Rectangle){ 0, 0, camera->target.texture.width, -camera->target.texture.height },
-        (Rectangle){ 0, 0, camera->target.texture.width, camera->target.texture.height },
-        (Vector2){0}, 0, WHITE);
+    const uint32_t k1 = ((const M7_ZBuffer_SortKey*)a)->key;
+    const uint32_t k2 = ((const M7_ZBuffer_SortKey*)b)->key;
+    return (k1 > k2) - (k1 < k2);
 }
 
 /**
- * Set the position of the Mode 7 camera.
+ * Sort the Mode 7 Z-Buffer elements with an insertion sort, starting from their current order.
+ * Since the order hardly changes from one frame to the next, only a few moves are usually needed.
  *
- * @param camera The camera to set the position for.
- * @param position The new position.
+ * @param view The view of the camera whose rendering order is sorted.
+ * @param count The number of elements to sort at the start of the order.
+ * @param maxMoves The maximum number of moves allowed before giving up (0 for no limit).
+ *
+ * @return True if the order is sorted, false if the sort was aborted (the order is then partially sorted).
  */
-void M7_Camera_SetPosition(M7_Camera* camera, Vector2 position)
+static bool M7_ZBuffer_InsertionSort(M7_ZBuffer_View* view, uint32_t count, uint32_t maxMoves)
 {
-    camera->position = position; // Position sent in addition to the origin of the plane in DrawPlane()
+    M7_ZBuffer_SortKey *order = view->order;
+    uint32_t moves = 0;
+
+    for (uint32_t i = 1; i < count; i++)
+    {
+        const M7_ZBuffer_SortKey entry = order[i];
+
+        uint32_t j = i;
+        while (j > 0 && order[j - 1].key > entry.key)
+        {
+            order[j] = order[j - 1], j--;
+        }
+
+        order[j] = entry;
+        moves += i - j;
+
+        if (maxMoves > 0 && moves > maxMoves)
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 /**
- * Set the rotation of the Mode 7 camera.
+ * Sort the Mode 7 Z-Buffer elements with a LSD radix sort on the keys of the rendering order.
  *
- * @param camera The camera to set the rotation for.
- * @param rotation The new rotation.
+ * @param view The view of the camera whose rendering order is sorted.
+ * @param count The number of elements to sort at the start of the order.
  */
-void M7_Camera_SetRotation(M7_Camera* camera, float rotation)
+static void M7_ZBuffer_RadixSort(M7_ZBuffer_View* view, uint32_t count)
 {
-    camera->rotation = rotation;
+    M7_ZBuffer_SortKey *order = view->order;
+    M7_ZBuffer_SortKey *orderTemp = view->orderTemp;
 
-    float cosR = cosf(rotation);
-    float sinR = sinf(rotation);
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        uint32_t histogram[256] = {0};
 
-    camera->rotMat.m0 = cosR;
-    camera->rotMat.m1 = -sinR;
-    camera->rotMat.m2 = sinR;
-    camera->rotMat.m3 = cosR;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            histogram[(order[i].key >> shift) & 0xFF]++;
+        }
+
+        // Skip the pass if all the keys have the same byte
+
+        if (histogram[(order[0].key >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        for (uint32_t i = 0, sum = 0; i < 256; i++)
+        {
+            uint32_t n = histogram[i];
+            histogram[i] = sum, sum += n;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            orderTemp[histogram[(order[i].key >> shift) & 0xFF]++] = order[i];
+        }
+
+        M7_ZBuffer_SortKey *tmp = order; order = orderTemp; orderTemp = tmp;
+    }
+
+    // After an odd number of passes the result is in the temporary array
 
-    glUseProgram(camera->planeProgram.shader.id);
-    glUniformMatrix2fv(camera->planeProgram.locCamRot, 1, GL_FALSE, (float*)(&camera->rotMat));
+    if (order != view->order)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            view->order[i] = order[i];
+        }
+    }
 }
 
 /**
- * Set the zoom of the Mode 7 camera.
+ * Sort the Mode 7 Z-Buffer elements based on their distance from the camera,
+ * using the sort strategy of the view, and record the sort path that ran.
  *
- * @param camera The camera to set the zoom for.
- * @param zoom The new zoom value.
+ * @param view The view of the camera whose rendering order is sorted.
+ * @param count The number of elements to sort at the start of the order.
  */
-void M7_Camera_SetZoom(M7_Camera* camera, float zoom)
+static void M7_ZBuffer_Sort(M7_ZBuffer_View* view, uint32_t count)
 {
-    camera->zoom = zoom;
+    switch (view->sortMode)
+    {
+        case M7_SORT_QUICK: {
+            qsort(view->order, count, sizeof(M7_ZBuffer_SortKey), M7_ZBuffer_Compare);
+            view->lastSort = M7_SORT_QUICK;
+        } break;
+
+        case M7_SORT_INSERTION: {
+            M7_ZBuffer_InsertionSort(view, count, 0);
+            view->lastSort = M7_SORT_INSERTION;
+        } break;
+
+        case M7_SORT_RADIX: {
+            if (count > 1) M7_ZBuffer_RadixSort(view, count);
+            view->lastSort = M7_SORT_RADIX;
+        } break;
 
-    SetShaderValue(
-        camera->planeProgram.shader,
-        camera->planeProgram.locZoom,
-        &zoom, SHADER_UNIFORM_FLOAT);
+        default: {
+            if (M7_ZBuffer_InsertionSort(view, count, count * M7_SORT_INSERTION_MAX_MOVES))
+            {
+                view->lastSort = M7_SORT_INSERTION;
+            }
+            else
+            {
+                M7_ZBuffer_RadixSort(view, count);
+                view->lastSort = M7_SORT_RADIX;
+            }
+        } break;
+    }
 }
 
 /**
- * Set the field of view (FOV) of the Mode 7 camera.
+ * Move the translucent elements (tint alpha below 255) to the start of the draw list for the depth buffer mode.
+ * The partition is stable so that the previous order of the translucent elements is kept for the sort.
  *
- * @param camera The camera to set the FOV for.
- * @param fov The new FOV value.
+ * @param buffer The Mode 7 Z-Buffer of the elements.
+ * @param view The view of the camera whose draw list is partitioned.
+ *
+ * @return True if at least one element has changed position.
  */
-void M7_Camera_SetFOV(M7_Camera* camera, float fov)
+static bool M7_ZBuffer_Partition(const M7_ZBuffer* buffer, M7_ZBuffer_View* view)
 {
-    camera->fov = fov;
+    M7_ZBuffer_SortKey *order = view->order;
+    M7_ZBuffer_SortKey *opaque = view->orderTemp;
+
+    uint32_t translucentCount = 0, opaqueCount = 0;
+    bool moved = false;
+
+    for (uint32_t i = 0; i < view->visibleCount; i++)
+    {
+        if (buffer->elems[order[i].index]->tint.a < 255)
+        {
+            moved |= (translucentCount != i);
+            order[translucentCount++] = order[i];
+        }
+        else
+        {
+            opaque[opaqueCount++] = order[i];
+        }
+    }
+
+    for (uint32_t i = 0; i < opaqueCount; i++)
+    {
+        moved |= (order[translucentCount + i].index != opaque[i].index);
+        order[translucentCount + i] = opaque[i];
+    }
 
-    SetShaderValue(
-        camera->planeProgram.shader,
-        camera->planeProgram.locFOV,
-        &fov, SHADER_UNIFORM_FLOAT);
+    view->translucentCount = translucentCount;
+
+    return moved;
 }
 
 /**
- * Set the offset of the Mode 7 camera.
+ * Project a range of the transform arrays of a Mode 7 Z-Buffer into the arrays of a view, with the same math as M7_ToScreen().
+ * The loop only reads and writes contiguous float arrays so that the compiler can vectorize it.
  *
- * @param camera The camera to set the offset for.
- * @param offset The new offset value.
+ * @param buffer The Mode 7 Z-Buffer.
+ * @param view The view of the camera.
+ * @param camera The Mode 7 camera.
+ * @param first The index of the first element to project.
+ * @param count The number of elements to project.
  */
-void M7_Camera_SetOffset(M7_Camera* camera, float offset)
+static void M7_ZBuffer_Project(const M7_ZBuffer* buffer, M7_ZBuffer_View* view, const M7_Camera* camera, uint32_t first, uint32_t count)
 {
-    camera->offset = offset;
+    const float *restrict positionX = buffer->transforms.positionX + first;
+    const float *restrict positionY = buffer->transforms.positionY + first;
+    float *restrict screenX = view->screenX + first;
+    float *restrict screenY = view->screenY + first;
+    float *restrict distance = view->distance + first;
+
+    const float camX = camera->position.x, camY = camera->position.y;
+    const float m0 = camera->rotMat.m0, m1 = camera->rotMat.m1;
+    const float m2 = camera->rotMat.m2, m3 = camera->rotMat.m3;
+    const float zoom = camera->zoom, fov = camera->fov, offset = camera->offset;
+    const float width = camera->target.texture.width, height = camera->target.texture.height;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float objX = -(camX - positionX[i]) / zoom;
+        const float objY = (camY - positionY[i]) / zoom;
+
+        const float spaceX = -objX * m0 - objY * m1;
+        const float spaceY = (objX * m2 + objY * m3) * fov;
 
-    SetShaderValue(
-        camera->planeProgram.shader,
-        camera->planeProgram.locOffset,
-        &offset, SHADER_UNIFORM_FLOAT);
+        const float d = 1 - spaceY;
+
+        screenX[i] = (spaceX / d) * offset * width + width / 2;
+        screenY[i] = ((spaceY + offset - 1) / d) * height + height;
+        distance[i] = (offset * width) / (zoom * d);
+    }
 }
 
 /**
- * Translate the Mode 7 camera by a given amount.
+ * Move the visible elements to the start of the rendering order, they form the draw list of the frame.
+ * The partition is stable so that the previous order of the visible elements is kept for the sort.
+ * When the spatial index has been queried, only the previous draw list and the elements returned by the query are visited.
  *
- * @param camera The camera to translate.
- * @param dx The change in X position.
- * @param dy The change in Y position.
+ * @param buffer The Mode 7 Z-Buffer of the elements.
+ * @param view The view of the camera whose rendering order is partitioned.
  */
-void M7_Camera_Translate(M7_Camera* camera, float dx, float dy)
+static void M7_ZBuffer_Cull(const M7_ZBuffer* buffer, M7_ZBuffer_View* view)
 {
-    M7_Camera_SetPosition(camera, (Vector2) {
-        camera->position.x + (dx * camera->rotMat.m0 + dy * camera->rotMat.m1),
-        camera->position.y + (dx * camera->rotMat.m2 + dy * camera->rotMat.m3)
-    });
+    if (buffer->grid && buffer->grid->active)
+    {
+        M7_ZBuffer_CullCandidates(buffer, view);
+        return;
+    }
+
+    M7_ZBuffer_SortKey *order = view->order;
+    M7_ZBuffer_SortKey *hidden = view->orderTemp;
+
+    uint32_t visibleCount = 0, hiddenCount = 0;
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        if (view->visible[order[i].index])
+        {
+            order[visibleCount++] = order[i];
+        }
+        else
+        {
+            hidden[hiddenCount++] = order[i];
+        }
+    }
+
+    // The order of the hidden elements does not matter
+
+    for (uint32_t i = 0; i < hiddenCount; i++)
+    {
+        order[visibleCount + i] = hidden[i];
+    }
+
+    for (uint32_t i = 0; i < buffer->count; i++)
+    {
+        view->orderOf[order[i].index] = i;
+    }
+
+    view->visibleCount = visibleCount;
 }
 
 /**
- * Rotate the Mode 7 camera by a specified delta angle.
+ * Swap two entries of the rendering order of a view, keeping track of their positions.
  *
- * @param camera The camera to rotate.
- * @param delta The rotation angle change.
+ * @param view The view of the camera.
+ * @param a The position of the first entry.
+ * @param b The position of the second entry.
  */
-void M7_Camera_Rotate(M7_Camera* camera, float delta)
+static void M7_ZBuffer_SwapOrder(M7_ZBuffer_View* view, uint32_t a, uint32_t b)
 {
-    M7_Camera_SetRotation(camera, camera->rotation + delta);
+    const M7_ZBuffer_SortKey entry = view->order[a];
+    view->order[a] = view->order[b];
+    view->order[b] = entry;
+
+    view->orderOf[view->order[a].index] = a;
+    view->orderOf[view->order[b].index] = b;
 }
 
 /**
- * Move the Mode 7 camera based on user input and speed.
+ * Rebuild the draw list from the previous one and the elements returned by the query of the spatial index.
+ * The elements of the previous draw list that are still visible keep their order, the newly visible ones
+ * are appended, and the entries are moved by swaps so that the rest of the rendering order is not visited.
  *
- * @param camera The camera to move.
- * @param speed The movement speed.
+ * @param buffer The Mode 7 Z-Buffer of the elements.
+ * @param view The view of the camera whose rendering order is partitioned.
  */
-void M7_Camera_Move(M7_Camera* camera, float speed)
+static void M7_ZBuffer_CullCandidates(const M7_ZBuffer* buffer, M7_ZBuffer_View* view)
 {
-    float dt = GetFrameTime(); speed *= dt;
+    const M7_ZBuffer_SortKey *order = view->order;
+    const uint32_t *orderOf = view->orderOf;
 
-    float dx = (IsKeyDown(KEY_A) - IsKeyDown(KEY_D));
-    float dy = (IsKeyDown(KEY_W) - IsKeyDown(KEY_S));
+    const uint32_t previousCount = (view->visibleCount < buffer->count) ? view->visibleCount : buffer->count;
+    uint32_t visibleCount = 0;
 
-    if (dx || dy)
+    // The elements of the previous draw list that are still visible stay within it
+
+    for (uint32_t i = 0; i < previousCount; i++)
     {
-        float mag = sqrtf(dx*dx + dy*dy);
-        dx /= mag, dy /= mag;
+        if (!view->visible[order[i].index]) continue;
+        M7_ZBuffer_SwapOrder(view, i, visibleCount++);
     }
 
-    M7_Camera_Translate(camera, dx*speed, dy*speed);
-    M7_Camera_Rotate(camera, (IsKeyDown(KEY_RIGHT) - IsKeyDown(KEY_LEFT)) * dt);
+    // The entries after the previous draw list are either hidden or returned by the query
 
-    M7_Camera_SetFOV(camera, camera->fov + -GetMouseWheelMove() * 0.1f);
-    M7_Camera_SetZoom(camera, camera->zoom + (IsKeyDown(KEY_DOWN) - IsKeyDown(KEY_UP)) * speed);
-    M7_Camera_SetOffset(camera, camera->offset + (IsKeyDown(KEY_PAGE_DOWN) - IsKeyDown(KEY_PAGE_UP)) * dt);
+    for (uint32_t i = 0; i < buffer->grid->candidateCount; i++)
+    {
+        const uint32_t position = orderOf[buffer->grid->candidates[i]];
+        if (position < previousCount || !view->visible[order[position].index]) continue;
+        M7_ZBuffer_SwapOrder(view, position, visibleCount++);
+    }
+
+    view->visibleCount = visibleCount;
 }
 
 /**
- * Convert world coordinates to screen coordinates using the Mode 7 camera.
+ * Update the projection of the elements in the view of the camera based on the camera's state.
+ * In retained mode, only the elements modified since the view last projected them are updated, unless the camera has changed.
+ * When the spatial index can be queried, only the elements under the view of the camera are updated,
+ * and the elements of the previous draw list that are no longer under it are hidden.
  *
  * @param camera The Mode 7 camera.
- * @param point The world coordinates to convert.
  *
- * @return The screen coordinates in Vector3 format with (x, y) and distance (z).
+ * @return The number of elements that have been updated or hidden.
  */
-Vector3 M7_ToScreen(M7_Camera* camera, Vector2 point)
+static uint32_t M7_ZBuffer_Update(M7_Camera* camera)
 {
-    // Determine the coordinates in camera space
-    float objX = -(camera->position.x - point.x) / camera->zoom;
-    float objY = (camera->position.y - point.y) / camera->zoom;
+    M7_ZBuffer* buffer = &camera->world->buffer;
+    M7_ZBuffer_View* view = camera->view;
+    M7_SpatialIndex* grid = buffer->grid;
+
+    M7_ZBuffer_UpdateData data = {
+        .camera = camera,
+        .indices = NULL,
+        .count = buffer->count,
+        .minDistance = 0
+    };
 
-    // Apply the camera rotation
-    float spaceX = -objX * camera->rotMat.m0 - objY * camera->rotMat.m1;
-    float spaceY = (objX * camera->rotMat.m2 + objY * camera->rotMat.m3) * camera->fov;
+    if (camera->farDistance > 0)
+    {
+        const float farDepth = 1 + camera->fov * camera->farDistance / camera->zoom;
+        data.minDistance = (camera->offset * camera->target.texture.width) / (camera->zoom * farDepth);
+    }
 
-    // Calculate the distance relative to the camera
-    float distance = 1 - spaceY;
+    if (grid)
+    {
+        M7_SpatialIndex_Update(grid, buffer);
+        grid->active = M7_SpatialIndex_Query(grid, buffer, camera);
+
+        if (grid->active)
+        {
+            data.indices = grid->candidates;
+            data.count = grid->candidateCount;
+        }
+    }
 
-    // Calculate the coordinates on the screen
-    float screenPosX = (spaceX / distance) * camera->offset * camera->target.texture.width + camera->target.texture.width / 2;
-    float screenPosY = ((spaceY + camera->offset - 1) / distance) * camera->target.texture.height + camera->target.texture.height;
+    const uint32_t batchCount = (data.count + M7_JOB_BATCH_SIZE - 1) / M7_JOB_BATCH_SIZE;
+    uint32_t updated = 0;
 
-    // Calculate the approximate size in pixels on the plane
-    float size = (camera->offset * camera->target.texture.width) / (camera->zoom * distance);
+    M7_Camera_ParallelFor(camera, M7_ZBuffer_UpdateJob, &data, batchCount);
 
-    return (Vector3) { screenPosX, screenPosY, size };
+    for (uint32_t i = 0; i < batchCount; i++)
+    {
+        updated += view->batchUpdated[i];
+    }
+
+    if (grid && grid->active)
+    {
+        const uint32_t previousCount = (view->visibleCount < buffer->count) ? view->visibleCount : buffer->count;
+
+        for (uint32_t i = 0; i < previousCount; i++)
+        {
+            const uint32_t index = view->order[i].index;
+
+            if (view->visible[index] && grid->stamps[buffer->elems[index]->slot] != grid->frame)
+            {
+                view->visible[index] = false;
+                updated++;
+            }
+        }
+    }
+
+    view->version = camera->version;
+
+    return updated;
 }
 
 /**
- * Convert screen coordinates to world coordinates using the Mode 7 camera.
+ * Job updating batches of elements in the view of the camera, run by M7_ZBuffer_Update().
+ * In retained mode, only the elements modified since the view last projected them are updated, unless the camera has changed.
+ * The number of elements updated by each batch is written to the 'batchUpdated' array of the view.
  *
- * @param camera The Mode 7 camera.
- * @param point The screen coordinates to convert.
- *
- * @return The world coordinates in Vector2 format.
+ * @param data The update data (M7_ZBuffer_UpdateData).
+ * @param first The index of the first batch to update.
+ * @param count The number of batches to update.
  */
-Vector2 M7_ToWorld(M7_Camera* camera, Vector2 point)
+static void M7_ZBuffer_UpdateJob(void* data, uint32_t first, uint32_t count)
 {
-    float sx = (camera->target.texture.width / 2 - point.x) * (camera->zoom / camera->aspect);
-    float sy = (camera->offset * camera->target.texture.height - point.y) * (camera->zoom / camera->fov);
+    const M7_ZBuffer_UpdateData *update = (const M7_ZBuffer_UpdateData*)data;
+    const M7_Camera *camera = update->camera;
+    M7_ZBuffer *buffer = &camera->world->buffer;
+    M7_ZBuffer_View *view = camera->view;
 
-    float rotX = sx * camera->rotMat.m0 + sy * camera->rotMat.m1;
-    float rotY = sx * camera->rotMat.m2 + sy * camera->rotMat.m3;
+    const bool all = !(camera->state & M7_STATE_RETAINED) || view->version != camera->version;
+    const float width = camera->target.texture.width, height = camera->target.texture.height;
 
-    return (Vector2) {
-        rotX / point.y + camera->position.x,
-        rotY / point.y + camera->position.y
-    };
-}
+    for (uint32_t batch = first; batch < first + count; batch++)
+    {
+        const uint32_t begin = batch * M7_JOB_BATCH_SIZE;
+        const uint32_t end = (begin + M7_JOB_BATCH_SIZE < update->count) ? begin + M7_JOB_BATCH_SIZE : update->count;
 
-/*
-    Element management functions rendering of world space in perspective
-*/
+        uint32_t updated = 0;
+
+        if (all && !update->indices)
+        {
+            // Contiguous range of the transform arrays, projected in one loop
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                M7_ZBuffer_Element_Sync(buffer, buffer->elems[i]);
+            }
+
+            M7_ZBuffer_Project(buffer, view, camera, begin, end - begin);
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const M7_ZBuffer_Element *elem = buffer->elems[i];
+                M7_ZBuffer_Element_Update(view, elem);
+                view->visible[i] = M7_ZBuffer_Element_IsVisible(view, elem, width, height, update->minDistance);
+            }
+
+            updated = end - begin;
+        }
+        else
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const uint32_t index = update->indices ? update->indices[i] : i;
+
+                const M7_ZBuffer_Element *elem = buffer->elems[index];
+                if (!all && view->revisions[index] == elem->revision) continue;
+
+                M7_ZBuffer_Element_Sync(buffer, elem);
+                M7_ZBuffer_Project(buffer, view, camera, index, 1);
+                M7_ZBuffer_Element_Update(view, elem);
+                view->visible[index] = M7_ZBuffer_Element_IsVisible(view, elem, width, height, update->minDistance);
+                updated++;
+            }
+        }
+
+        view->batchUpdated[batch] = updated;
+    }
+}
 
 /**
- * Add a textured element to the Mode 7 camera's world space in perspective.
- *
- * @param camera The Mode 7 camera.
- * @param texture The texture to add.
- * @param source The source rectangle of the texture.
- * @param position The position of the element.
- * @param scale The scale of the element.
- * @param tint The tint color of the element.
+ * Job updating the sort keys of batches of entries of the draw list, run by M7_Camera_End().
+ * The distances are converted to unsigned keys preserving the order of the floats.
  *
- * @return A pointer to the added Mode 7 element.
+ * @param data The view of the camera (M7_ZBuffer_View).
+ * @param first The index of the first batch to update.
+ * @param count The number of batches to update.
  */
-M7_Element* M7_Texture_Add(M7_Camera* camera, Texture2D texture, Rectangle source, Vector2 position, Vector2 scale, Color tint)
+static void M7_ZBuffer_UpdateKeysJob(void* data, uint32_t first, uint32_t count)
 {
-    M7_ZBuffer_Element tex = {
-        
-        .onWorld = (struct M7_ZBuffer_Element_SpaceData) {
-            .rectangle = source,
-            .position = position,
-            .scale = scale
-        },
+    M7_ZBuffer_View *view = (M7_ZBuffer_View*)data;
+    const float *distance = view->distance;
 
-        .type = M7_ZBT_TEXTURE,
-        .texture = texture,
-        .tint = tint
-    };
+    const uint32_t begin = first * M7_JOB_BATCH_SIZE;
+    const uint32_t end = ((first + count) * M7_JOB_BATCH_SIZE < view->visibleCount) ? (first + count) * M7_JOB_BATCH_SIZE : view->visibleCount;
 
-    return M7_ZBuffer_Element_Add(&camera->buffer, &tex);
+    for (uint32_t i = begin; i < end; i++)
+    {
+        union { float f; uint32_t u; } key = { distance[view->order[i].index] };
+        view->order[i].key = (key.u & 0x80000000) ? ~key.u : (key.u | 0x80000000);
+    }
 }
 
 /**
- * Add a rectangle element to the Mode 7 camera's world space in perspective.
+ * Run a job over a range of batches with the parallel for callback of the camera, or directly
+ * on the calling thread when there is no callback or a single batch.
  *
  * @param camera The Mode 7 camera.
- * @param rectangle The rectangle to add.
- * @param tint The tint color of the element.
- *
- * @return A pointer to the added Mode 7 element.
+ * @param job The job to run.
+ * @param data The data given to the job.
+ * @param count The number of batches.
  */
-M7_Element* M7_Rectangle_Add(M7_Camera* camera, Rectangle rectangle, Color tint)
+static void M7_Camera_ParallelFor(M7_Camera* camera, M7_Job job, void* data, uint32_t count)
 {
-    M7_ZBuffer_Element rect = {
-        
-        .onWorld = (struct M7_ZBuffer_Element_SpaceData) {
-            .rectangle = (Rectangle) { rectangle.x, rectangle.y, 1.0f, 1.0f },
-            .position = (Vector2) { rectangle.x, rectangle.y },
-            .scale = (Vector2) { rectangle.width, rectangle.height }
-        },
-
-        .type = M7_ZBT_RECTANGLE,
-        .tint = tint
-    };
+    if (count == 0) return;
 
-    return M7_ZBuffer_Element_Add(&camera->buffer, &rect);
+    if (camera->parallelFor && count > 1)
+    {
+        camera->parallelFor(job, data, count, camera->parallelData);
+    }
+    else
+    {
+        job(data, 0, count);
+    }
 }
 
 /**
- * Add a circle element to the Mode 7 camera's world space in perspective.
+ * Render a run of sorted texture elements sharing the same texture with one instanced draw call.
+ * The instance attributes must have been written to the instance buffer beforehand.
  *
  * @param camera The Mode 7 camera.
- * @param position The position of the circle.
- * @param radius The radius of the circle.
- * @param tint The tint color of the element.
- *
- * @return A pointer to the added Mode 7 element.
+ * @param texture The texture shared by the elements of the run.
+ * @param first The index of the first instance of the run in the instance buffer.
+ * @param count The number of instances of the run.
  */
-M7_Element* M7_Circle_Add(M7_Camera* camera, Vector2 position, float radius, Color tint)
+static void M7_ZBuffer_DrawRun(M7_Camera* camera, Texture2D texture, uint32_t first, uint32_t count)
 {
-    M7_ZBuffer_Element circle = {
-        
-        .onWorld = (struct M7_ZBuffer_Element_SpaceData) {
+    const float texSize[2] = { (float)texture.width, (float)texture.height };
+    SetShaderValue(camera->programs->spriteProgram.shader, camera->programs->spriteProgram.locTexSize, texSize, SHADER_UNIFORM_VEC2);
 
-            .rectangle = (Rectangle) {
-                position.x - radius,
-                position.y - radius,
-                1.0f, 1.0f
-            },
+    // GL 3.3 has no base instance, the attribute pointers are moved to the start of the run instead
 
-            .position = position,
-            .scale = (Vector2) { radius, radius }
+    const size_t base = first * sizeof(M7_SpriteInstance);
+    const GLsizei stride = sizeof(M7_SpriteInstance);
 
-        },
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(M7_SpriteInstance, position)));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(M7_SpriteInstance, scale)));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(M7_SpriteInstance, source)));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(base + offsetof(M7_SpriteInstance, tint)));
 
-        .type = M7_ZBT_CIRCLE,
-        .tint = tint
-    };
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
 
-    return M7_ZBuffer_Element_Add(&camera->buffer, &circle);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
 }
 
-/*
-    Z-Buffer functions management (functions automatically called by the module)
-*/
-
 /**
- * Load a new Mode 7 Z-Buffer with a specified maximum number of elements.
+ * Render a list of sorted Mode 7 Z-Buffer elements, drawing the texture elements with instancing.
+ * Consecutive texture elements sharing a texture are drawn in one call, the other elements
+ * are drawn with raylib between the runs so that the depth order is preserved.
  *
- * @param maxElements The maximum number of elements the Z-Buffer can hold.
- *
- * @return The initialized Mode 7 Z-Buffer.
+ * @param camera The Mode 7 camera.
+ * @param order The entries of the rendering order of the elements to draw.
+ * @param count The number of elements to draw.
+ * @param alphaCutoff The alpha below which the texels of the texture elements are discarded.
  */
-static M7_ZBuffer M7_ZBuffer_Load(uint32_t maxElements)
+static void M7_ZBuffer_DrawInstanced(M7_Camera* camera, const M7_ZBuffer_SortKey* order, uint32_t count, float alphaCutoff)
 {
-    M7_ZBuffer buffer = {0};
+    M7_ZBuffer_Element **elems = camera->world->buffer.elems;
+    const M7_ZBuffer_View *view = camera->view;
+    const bool depth = (camera->state & M7_STATE_DEPTH_BUFFER);
 
-    if (maxElements > 0)
-    {
-        buffer.elems = (M7_ZBuffer_Element*)malloc(maxElements * sizeof(M7_ZBuffer_Element));
-        buffer.ptrElems = (M7_ZBuffer_Element**)malloc(maxElements * sizeof(M7_ZBuffer_Element*));
-    }
-    else
+    // Write the instance attributes of all texture elements in rendering order
+
+    if (camera->spriteBatch.capacity < count)
     {
-        buffer.elems = NULL;
-        buffer.ptrElems = NULL;
+        camera->spriteBatch.capacity = count;
+        camera->spriteBatch.instances = (M7_SpriteInstance*)realloc(
+            camera->spriteBatch.instances, count * sizeof(M7_SpriteInstance));
     }
 
-    buffer.maxCount = maxElements;
-    buffer.count = 0;
+    uint32_t instanceCount = 0;
 
-    return buffer;
-}
-
-/**
- * Unload a Mode 7 Z-Buffer, freeing associated resources.
- *
- * @param buffer The Mode 7 Z-Buffer to unload.
- */
-static void M7_ZBuffer_Unload(M7_ZBuffer* buffer)
-{
-    if (buffer->ptrElems)
+    for (uint32_t i = 0; i < count; i++)
     {
-        free(buffer->ptrElems);
-        buffer->ptrElems = NULL;
+        const M7_ZBuffer_Element *elem = elems[order[i].index];
+        if (elem->type != M7_ZBT_TEXTURE) continue;
+
+        camera->spriteBatch.instances[instanceCount++] = (M7_SpriteInstance) {
+            { elem->onWorld.position.x, elem->onWorld.position.y },
+            { elem->onWorld.scale.x, elem->onWorld.scale.y },
+            { elem->onWorld.rectangle.x, elem->onWorld.rectangle.y, elem->onWorld.rectangle.width, elem->onWorld.rectangle.height },
+            { elem->tint.r, elem->tint.g, elem->tint.b, elem->tint.a }
+        };
     }
 
-    if (buffer->elems)
+    if (instanceCount == 0)
     {
-        free(buffer->elems);
-        buffer->elems = NULL;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (depth) M7_ZBuffer_Element_DrawDepth(view, elems[order[i].index]);
+            else M7_ZBuffer_Element_Draw(view, elems[order[i].index]);
+        }
+
+        M7_STATS_COUNT(camera, batchedElements, count);
+        return;
     }
 
-    buffer->maxCount = 0;
-    buffer->count = 0;
-}
+    rlDrawRenderBatchActive();
 
-/**
- * Add a Mode 7 Z-Buffer element to the buffer.
- *
- * @param buffer The Mode 7 Z-Buffer.
- * @param elem The Mode 7 Z-Buffer element to add.
- *
- * @return A pointer to the added Mode 7 Z-Buffer element.
- */
-static M7_ZBuffer_Element* M7_ZBuffer_Element_Add(M7_ZBuffer* buffer, M7_ZBuffer_Element* elem)
-{
-    if (buffer->count == buffer->maxCount) return NULL;
+    glBindVertexArray(camera->spriteBatch.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, camera->spriteBatch.vbo);
+    glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(M7_SpriteInstance), camera->spriteBatch.instances, GL_STREAM_DRAW);
 
-    M7_ZBuffer_Element *ptr = buffer->elems + buffer->count;
-    *ptr = *elem, buffer->ptrElems[buffer->count] = ptr;
+    for (GLuint i = 0; i < 4; i++)
+    {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
 
-    return &(buffer->elems[buffer->count++]);
-}
+    // Camera uniforms of the frame
 
-/**
- * Update a Mode 7 Z-Buffer element based on the camera's state.
- *
- * @param elem The Mode 7 Z-Buffer element to update.
- * @param camera The Mode 7 camera.
- */
-static void M7_ZBuffer_Element_Update(M7_ZBuffer_Element* elem, M7_Camera* camera)
-{
-    Vector3 posAndSize = M7_ToScreen(camera, elem->onWorld.position);
+    const float targetSize[2] = { (float)camera->target.texture.width, (float)camera->target.texture.height };
+    const float camPos[2] = { camera->position.x, camera->position.y };
 
-    elem->onScreen.scale.x = (posAndSize.z * elem->onWorld.scale.x) / elem->onWorld.rectangle.width;
-    elem->onScreen.scale.y = (posAndSize.z * elem->onWorld.scale.y) / elem->onWorld.rectangle.height;
+    SetShaderValue(camera->programs->spriteProgram.shader, camera->programs->spriteProgram.locTargetSize, targetSize, SHADER_UNIFORM_VEC2);
+    SetShaderValue(camera->programs->spriteProgram.shader, camera->programs->spriteProgram.locCamPos, camPos, SHADER_UNIFORM_VEC2);
+    SetShaderValue(camera->programs->spriteProgram.shader, camera->programs->spriteProgram.locZoom, &camera->zoom, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(camera->programs->spriteProgram.shader, camera->programs->spriteProgram.locFOV, &camera->fov, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(camera->programs->spriteProgram.shader, camera->programs->spriteProgram.locOffset, &camera->offset, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(camera->programs->spriteProgram.shader, camera->programs->spriteProgram.locAlphaCutoff, &alphaCutoff, SHADER_UNIFORM_FLOAT);
 
-    elem->onScreen.rectangle = (Rectangle) {
+    glUseProgram(camera->programs->spriteProgram.shader.id);
+    glUniformMatrix2fv(camera->programs->spriteProgram.locCamRot, 1, GL_FALSE, (float*)(&camera->rotMat));
 
-        posAndSize.x - (elem->onWorld.rectangle.width * elem->onScreen.scale.x) * 0.5f,
-        posAndSize.y - elem->onWorld.rectangle.height * elem->onScreen.scale.y,
+    // Walk the elements in rendering order, splitting the runs on texture changes and on other element types
 
-        elem->onWorld.rectangle.width * elem->onScreen.scale.x,
-        elem->onWorld.rectangle.width * elem->onScreen.scale.y
+    uint32_t runFirst = 0, runCount = 0;
+    Texture2D runTexture = { 0 };
 
-    };
+    for (uint32_t i = 0, instance = 0; i <= count; i++)
+    {
+        M7_ZBuffer_Element *elem = (i < count) ? elems[order[i].index] : NULL;
+        const bool isTexture = elem && elem->type == M7_ZBT_TEXTURE;
+
+        if (runCount > 0 && (!isTexture || elem->texture.id != runTexture.id))
+        {
+            glUseProgram(camera->programs->spriteProgram.shader.id);
+            M7_ZBuffer_DrawRun(camera, runTexture, runFirst, runCount);
+            M7_STATS_COUNT(camera, drawCalls, 1);
+            runCount = 0;
+        }
+
+        if (isTexture)
+        {
+            if (runCount == 0) runFirst = instance, runTexture = elem->texture;
+            runCount++, instance++;
+        }
+        else if (elem)
+        {
+            // Shapes are batched by raylib, the batch is flushed
+            // before the next run to keep them in depth order
+
+            glBindVertexArray(0);
+
+            if (depth) M7_ZBuffer_Element_DrawDepth(view, elem);
+            else M7_ZBuffer_Element_Draw(view, elem);
+
+            rlDrawRenderBatchActive();
+            glBindVertexArray(camera->spriteBatch.vao);
+            glBindBuffer(GL_ARRAY_BUFFER, camera->spriteBatch.vbo);
+
+            M7_STATS_COUNT(camera, drawCalls, 1);
+        }
+    }
 
-    elem->onScreen.position = (Vector2) { posAndSize.x, posAndSize.y };
-    elem->distance = posAndSize.z;
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 /**
- * Draw a Mode 7 Z-Buffer element.
+ * Render the visible elements of the Mode 7 Z-Buffer with the depth buffer of the render target.
+ * The opaque elements are drawn first in any order, alpha tested and writing their depth,
+ * then the translucent elements are drawn sorted by depth, depth tested without writing it.
  *
- * @param elem The Mode 7 Z-Buffer element to draw.
+ * @param camera The Mode 7 camera.
  */
-static void M7_ZBuffer_Element_Draw(M7_ZBuffer_Element* elem)
+static void M7_ZBuffer_DrawDepth(M7_Camera* camera)
 {
-    switch (elem->type)
-    {
-        case M7_ZBT_TEXTURE: {
+    M7_ZBuffer* buffer = &camera->world->buffer;
+    const M7_ZBuffer_View* view = camera->view;
 
-            // Checks whether the scale is unintentionally flipped.
-            // (Occurs when the object is behind the camera)
+    const M7_ZBuffer_SortKey *translucent = view->order;
+    const M7_ZBuffer_SortKey *opaque = view->order + view->translucentCount;
+    const uint32_t opaqueCount = view->visibleCount - view->translucentCount;
+
+    rlDrawRenderBatchActive();
+    rlDisableBackfaceCulling();
+    rlEnableDepthTest();
 
-            if ( (elem->onScreen.scale.x > 0) == (elem->onWorld.scale.x > 0)
-              && (elem->onScreen.scale.y > 0) == (elem->onWorld.scale.y > 0) )
+    if (camera->state & M7_STATE_INSTANCING)
+    {
+        M7_ZBuffer_DrawInstanced(camera, opaque, opaqueCount, M7_DEPTH_ALPHA_CUTOFF);
+
+        rlDisableDepthMask();
+        M7_ZBuffer_DrawInstanced(camera, translucent, view->translucentCount, 0.0f);
+    }
+    else
+    {
+        BeginShaderMode(camera->programs->alphaTestProgram.shader);
+            for (uint32_t i = 0; i < opaqueCount; i++)
             {
-                DrawTexturePro(
-                    elem->texture,
-                    elem->onWorld.rectangle,
-                    elem->onScreen.rectangle,
-                    (Vector2) {0}, 0, elem->tint);
+                M7_ZBuffer_Element_DrawDepth(view, buffer->elems[opaque[i].index]);
             }
+        EndShaderMode();
 
-        } break;
+        rlDisableDepthMask();
 
-        case M7_ZBT_RECTANGLE: {
-            DrawRectangleRec(elem->onScreen.rectangle, elem->tint);
-        } break;
+        for (uint32_t i = 0; i < view->translucentCount; i++)
+        {
+            M7_ZBuffer_Element_DrawDepth(view, buffer->elems[translucent[i].index]);
+        }
 
-        case M7_ZBT_CIRCLE: {
-            Vector2 pos = elem->onScreen.position;
-            pos.y -= elem->onScreen.rectangle.width;
-            DrawCircleV(pos, elem->onScreen.rectangle.width, elem->tint);
-        } break;
+        M7_STATS_COUNT(camera, batchedElements, view->visibleCount);
     }
-}
-
-/**
- * Compare the distance of two Mode 7 Z-Buffer elements.
- *
- * @param a Pointer to the first Mode 7 Z-Buffer element.
- * @param b Pointer to the second Mode 7 Z-Buffer element.
- *
- * @return Negative if the first element is closer, positive if the second element is closer, or zero if they are at the same distance.
- */
-static int M7_ZBuffer_Compare(const void* a, const void* b)
-{
-    const M7_ZBuffer_Element *e1 = *(const M7_ZBuffer_Element**)a;
-    const M7_ZBuffer_Element *e2 = *(const M7_ZBuffer_Element**)b;
-    return (e1->distance > e2->distance) - (e1->distance < e2->distance);
-}
 
-/**
- * Sort the Mode 7 Z-Buffer elements based on their distance from the camera.
- *
- * @param buffer The Mode 7 Z-Buffer to sort.
- */
-static void M7_ZBuffer_Sort(M7_ZBuffer* buffer)
-{
-    qsort(buffer->ptrElems, buffer->count, sizeof(M7_ZBuffer_Element*), M7_ZBuffer_Compare);
+    rlDrawRenderBatchActive();
+    rlEnableDepthMask();
+    rlDisableDepthTest();
+    rlEnableBackfaceCulling();
 }
 
 /**
- * Update all elements in the Mode 7 Z-Buffer based on the camera's state.
+ * Render the visible elements of the Mode 7 Z-Buffer.
  *
  * @param camera The Mode 7 camera.
  */
-static void M7_ZBuffer_Update(M7_Camera* camera)
+static void M7_ZBuffer_Draw(M7_Camera* camera)
 {
-    M7_ZBuffer* buffer = &camera->buffer;
-    for (uint32_t i = 0; i < buffer->count; i++)
+    M7_ZBuffer* buffer = &camera->world->buffer;
+    const M7_ZBuffer_View* view = camera->view;
+
+    if (camera->state & M7_STATE_DEPTH_BUFFER)
     {
-        M7_ZBuffer_Element_Update(buffer->ptrElems[i], camera);
+        M7_ZBuffer_DrawDepth(camera);
+        return;
     }
-}
 
-/**
- * Render all elements in the Mode 7 Z-Buffer.
- *
- * @param buffer The Mode 7 Z-Buffer to render.
- */
-static void M7_ZBuffer_Draw(M7_ZBuffer* buffer)
-{
-    for (uint32_t i = 0; i < buffer->count; i++)
+    if (camera->state & M7_STATE_INSTANCING)
     {
-        M7_ZBuffer_Element_Draw(buffer->ptrElems[i]);
+        rlDisableBackfaceCulling();
+        M7_ZBuffer_DrawInstanced(camera, view->order, view->visibleCount, 0.0f);
+        rlEnableBackfaceCulling();
+        return;
     }
+
+    for (uint32_t i = 0; i < view->visibleCount; i++)
+    {
+        M7_ZBuffer_Element_Draw(view, buffer->elems[view->order[i].index]);
+    }
+
+    M7_STATS_COUNT(camera, batchedElements, view->visibleCount);
 }
 
 #endif // M7_IMPL
@@ -25,6 +25,7 @@
 #include <raylib.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <math.h>
 
 #define M7_IMPL
 #include "m7.h"
@@ -46,45 +47,116 @@ int main(void)
     // Data loading
 
     Texture2D textureGrid = GenTextureGrid(512, 64);
-    Texture2D textureGround = LoadTexture("res/ground.png");
-    Texture2D textureCharacter = LoadTexture("res/character.png");
 
-    Rectangle srcTexCharac = { 0, 0, textureCharacter.width, textureCharacter.height };
+    // The ground and character textures are decoded and uploaded over the first frames,
+    // their placeholders are drawn meanwhile (the source rectangles are then given in fractions of the texture)
+
+    M7_Loader loader = M7_Loader_Load(0, NULL, NULL);
+
+    M7_Asset *assetGround = M7_Loader_Add(&loader, "res/ground.png", false);
+    M7_Asset *assetCharacter = M7_Loader_Add(&loader, "res/character.png", false);
+
+    Rectangle srcTexCharac = { 0, 0, 1, 1 };
+
+    // The grid lines shimmer toward the horizon without mipmaps
+    // (the mipmap level of each row is chosen by the plane shader)
+
+    GenTextureMipmaps(&textureGrid);
+    SetTextureFilter(textureGrid, TEXTURE_FILTER_TRILINEAR);
+
+    // Ground tilemap (8x8 tiles of the ground texture, rendered in a single pass, loaded once the texture is ready)
+
+    M7_Tilemap tilemapGround = { 0 };
 
     // Camera setup
 
     M7_Camera camera = M7_Camera_Load(GetScreenWidth(), GetScreenHeight(), (Vector2) {0}, 0.0f, 80.0f, 0.5f, 0.5f, 48);
 
+    // Sprites are only projected again when they or the camera have changed,
+    // the sprites sharing a texture are drawn with a single instanced call
+    // and the per-row terms of the ground projection are taken from a table
+
+    M7_Camera_SetState(&camera, M7_STATE_RETAINED | M7_STATE_INSTANCING | M7_STATE_ROW_TABLE);
+
     // Placement of elements to be displayed
 
-    M7_Element *firstCharacter = M7_Texture_Add(&camera, textureCharacter, srcTexCharac, (Vector2) { 0, 0 }, (Vector2) { 8, 8 }, WHITE);
+    M7_Element *firstCharacter = M7_Texture_Add(&camera, assetCharacter->texture, srcTexCharac, (Vector2) { 0, 0 }, (Vector2) { 8, 8 }, WHITE);
 
     for (int i = 1; i < 10; i++)
     {
-        M7_Texture_Add(&camera, textureCharacter, srcTexCharac, (Vector2) { 0, i * -16 }, (Vector2) { 12, 12 }, WHITE);
-        M7_Texture_Add(&camera, textureCharacter, srcTexCharac, (Vector2) { -16, i * -16 }, (Vector2) { 8, 8 }, WHITE);
-        M7_Texture_Add(&camera, textureCharacter, srcTexCharac, (Vector2) { 16, i * -16 }, (Vector2) { 8, 8 }, WHITE);
-        M7_Texture_Add(&camera, textureCharacter, srcTexCharac, (Vector2) { -32, i * -16 }, (Vector2) { 8, 8 }, WHITE);
-        M7_Texture_Add(&camera, textureCharacter, srcTexCharac, (Vector2) { 32, i * -16 }, (Vector2) { 8, 8 }, WHITE);
+        M7_Texture_Add(&camera, assetCharacter->texture, srcTexCharac, (Vector2) { 0, i * -16 }, (Vector2) { 12, 12 }, WHITE);
+        M7_Texture_Add(&camera, assetCharacter->texture, srcTexCharac, (Vector2) { -16, i * -16 }, (Vector2) { 8, 8 }, WHITE);
+        M7_Texture_Add(&camera, assetCharacter->texture, srcTexCharac, (Vector2) { 16, i * -16 }, (Vector2) { 8, 8 }, WHITE);
+        M7_Texture_Add(&camera, assetCharacter->texture, srcTexCharac, (Vector2) { -32, i * -16 }, (Vector2) { 8, 8 }, WHITE);
+        M7_Texture_Add(&camera, assetCharacter->texture, srcTexCharac, (Vector2) { 32, i * -16 }, (Vector2) { 8, 8 }, WHITE);
     }
 
     M7_Rectangle_Add(&camera, (Rectangle) { 64, 64, 16, 16 }, RED);
     M7_Circle_Add(&camera, (Vector2) { -64, 64 }, 8, YELLOW);
 
+    M7_Element *dragged = firstCharacter;
+
     // Main loop
 
     while (!WindowShouldClose())
     {
+        // Upload of the assets, the sprites and the ground are given their textures once ready
+
+        if (M7_Loader_Update(&loader) > 0)
+        {
+            M7_Loader_Apply(&loader, &camera);
+
+            if (assetGround->state == M7_ASSET_READY && !tilemapGround.tiles)
+            {
+                Texture2D textureGround = assetGround->texture;
+                tilemapGround = M7_Tilemap_Load(textureGround, textureGround.width, textureGround.height, 8, 8, NULL);
+
+                for (int y = 0; y < tilemapGround.height; y++)
+                {
+                    for (int x = 0; x < tilemapGround.width; x++)
+                    {
+                        M7_Tilemap_SetTile(&tilemapGround, x, y, 0);
+                    }
+                }
+            }
+        }
+
         // Automatic camera control
 
         M7_Camera_Move(&camera, 64);
 
-        // Update movement of the first character using left mouse button click
+        // Water wobble of the ground while W is held, each row of the view being scrolled
+        // sideways (baked into the row table, so the planes are still rendered in a single pass)
+
+        if (IsKeyDown(KEY_W))
+        {
+            static M7_Scanline scanlines[SCREEN_HEIGHT];
+
+            for (int y = 0; y < SCREEN_HEIGHT; y++)
+            {
+                scanlines[y].scroll.x = 4.0f * sinf(0.05f * y + 4.0f * (float)GetTime());
+            }
+
+            M7_Camera_SetScanlines(&camera, scanlines, SCREEN_HEIGHT);
+        }
+        else
+        {
+            M7_Camera_SetScanlines(&camera, NULL, 0);
+        }
+
+        // Drag the element clicked with the left mouse button, or the first character when none is under the cursor
+        // (picked on the pixels drawn by the last frame, the transparent texels of the sprites are not hit)
+
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        {
+            dragged = M7_Camera_PickPixel(&camera, GetMousePosition());
+            if (!dragged) dragged = firstCharacter;
+        }
 
         if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
         {
             Vector2 wPos = M7_ToWorld(&camera, GetMousePosition());
-            firstCharacter->onWorld.position = wPos;
+            M7_Element_SetPosition(dragged, wPos);
         }
 
         // The commented-out call below is used to render everything automatically in one call,
@@ -109,17 +181,17 @@ int main(void)
                 goto skipTilesRendering;
             }
 
-            // NOTE: Displaying as many planes for performance testing purposes
+            // NOTE: The ground tiles are all rendered in a single pass with the tilemap
 
-            for (int y = -256; y < 256; y += textureGround.height)
+            if (tilemapGround.tiles)
             {
-                for (int x = -256; x < 256; x += textureGround.width)
-                {
-                    M7_Camera_DrawPlane(
-                        &camera, textureGround, (Vector2) { x, y },
-                        (Vector2) { textureGround.width, textureGround.height },
-                        (Vector2){ 1.0f, 1.0f }, false);
-                }
+                M7_Camera_DrawTilemap(&camera, &tilemapGround, (Vector2) {0},
+                    (Vector2) { 256, 256 }, (Vector2){ 1.0f, 1.0f }, false);
+            }
+            else
+            {
+                M7_Camera_DrawPlane(&camera, assetGround->texture, (Vector2) {0},
+                    (Vector2) { 256, 256 }, (Vector2){ 512.0f, 512.0f }, false);
             }
 
             for (int y = -1; y <= 1; y++)
@@ -147,11 +219,12 @@ int main(void)
 
     // Program closure
 
-    UnloadTexture(textureCharacter);
-    UnloadTexture(textureGround);
+    if (tilemapGround.tiles) M7_Tilemap_Unload(&tilemapGround);
+
     UnloadTexture(textureGrid);
 
     M7_Camera_Unload(&camera);
+    M7_Loader_Unload(&loader);
 
     CloseWindow();
 
@@ -201,7 +274,11 @@ Texture2D GenTextureGrid(uint16_t gridSize, uint8_t cellSize)
 */
 void DrawRenderInfo(M7_Camera* camera)
 {
-    Rectangle rec = { 8, 8, 320, 216 };
+#ifdef M7_STATS
+    Rectangle rec = { 8, 8, 560, 340 };
+#else
+    Rectangle rec = { 8, 8, 320, 240 };
+#endif
 
     // Info frame
 
@@ -224,5 +301,15 @@ void DrawRenderInfo(M7_Camera* camera)
 
     // Sprites info
 
-    DrawText(TextFormat("Sprite count: %i", camera->buffer.count), 16, 196, 20, BLACK);
+    static const char *sortNames[] = { "none", "auto", "quick", "insertion", "radix" };
+
+    DrawText(TextFormat("Sprite count: %i (%i visible)", camera->world->buffer.count, camera->view->visibleCount), 16, 196, 20, BLACK);
+    DrawText(TextFormat("Sort path: %s", sortNames[M7_Camera_GetSortPath(camera)]), 16, 216, 20, BLACK);
+
+    // Stages info (only measured when compiled with M7_STATS)
+
+#ifdef M7_STATS
+    DrawText("Stages:", 16, 256, 20, BLACK);
+    M7_Camera_DrawStats(camera, 32, 276, 16, BLACK);
+#endif
 }
\ No newline at end of file